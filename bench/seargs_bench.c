@@ -0,0 +1,345 @@
+// Measures parse throughput and allocations of seargs on synthetic specs and
+// command lines. Prints one JSON object per line, e.g:
+//   {"case":"parse_args","defs":100,"tokens":96,"iterations":2000,...}
+// Usage: seargs_bench [scale], scale multiplies the number of iterations.
+
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
+#include "../src/seargs.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* ------------------- */
+/* Allocation counting */
+/* ------------------- */
+
+// With SEARGS_BENCH_COUNT_ALLOCS the build wraps malloc and friends
+// (-Wl,--wrap) so every allocation made by the library is counted. Each block
+// carries its size in a header to track the live and peak bytes.
+static size_t alloc_count;
+static size_t live_bytes;
+static size_t peak_bytes;
+static size_t phase_base_bytes; // live when the measured phase began
+
+#ifdef SEARGS_BENCH_COUNT_ALLOCS
+typedef union {
+  size_t size;
+  long double align_;
+} alloc_header_t;
+
+void *__real_malloc(size_t size);
+void *__real_calloc(size_t count, size_t size);
+void *__real_realloc(void *ptr, size_t size);
+void __real_free(void *ptr);
+
+static void *track_(alloc_header_t *header, size_t size) {
+  if (!header) {
+    return NULL;
+  }
+  header->size = size;
+  alloc_count++;
+  live_bytes += size;
+  if (live_bytes > peak_bytes) {
+    peak_bytes = live_bytes;
+  }
+  return header + 1;
+}
+
+void *__wrap_malloc(size_t size) {
+  return track_(__real_malloc(sizeof(alloc_header_t) + size), size);
+}
+
+void *__wrap_calloc(size_t count, size_t size) {
+  return track_(__real_calloc(1, sizeof(alloc_header_t) + count * size),
+                count * size);
+}
+
+void __wrap_free(void *ptr) {
+  if (!ptr) {
+    return;
+  }
+  alloc_header_t *header = (alloc_header_t *)ptr - 1;
+  live_bytes -= header->size;
+  __real_free(header);
+}
+
+void *__wrap_realloc(void *ptr, size_t size) {
+  if (!ptr) {
+    return __wrap_malloc(size);
+  }
+  alloc_header_t *header = (alloc_header_t *)ptr - 1;
+  size_t old_size = header->size;
+  header = __real_realloc(header, sizeof(alloc_header_t) + size);
+  if (!header) {
+    return NULL;
+  }
+  live_bytes -= old_size;
+  return track_(header, size);
+}
+#endif
+
+/* ------ */
+/* Timing */
+/* ------ */
+
+static uint64_t now_ns(void) {
+#if defined(_WIN32)
+  return (uint64_t)clock() * (1000000000ULL / CLOCKS_PER_SEC);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+/* ------------------ */
+/* Synthetic workload */
+/* ------------------ */
+
+static const char short_names[] =
+    "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+
+// Every fourth def is a flag, int, double and string in turn. The first defs
+// get short names so that clusters can be formed from the flags among them.
+static arg_def_t *make_defs(int num_defs, char (*names)[24]) {
+  arg_def_t *defs = malloc(num_defs * sizeof(arg_def_t));
+  int num_short = (int)sizeof(short_names) - 1;
+  for (int i = 0; i < num_defs; i++) {
+    snprintf(names[i], sizeof(names[i]), "option-%d", i);
+    char short_name = i < num_short ? short_names[i] : 0;
+    // arg_def_t has const members, so defs are copied in whole
+    switch (i % 4) {
+    case 0:
+      memcpy(&defs[i], &FLAG_ARG(names[i], short_name, "a flag"),
+             sizeof(arg_def_t));
+      break;
+    case 1:
+      memcpy(&defs[i], &OPTIONAL_INT_ARG(names[i], short_name, "an int", 1),
+             sizeof(arg_def_t));
+      break;
+    case 2:
+      memcpy(&defs[i],
+             &OPTIONAL_DOUBLE_ARG(names[i], short_name, "a double", 1.5),
+             sizeof(arg_def_t));
+      break;
+    default:
+      memcpy(&defs[i],
+             &OPTIONAL_STRING_ARG(names[i], short_name, "a string", "default"),
+             sizeof(arg_def_t));
+      break;
+    }
+  }
+  return defs;
+}
+
+// Builds a command line touching up to 64 options spread over the spec: short
+// flag clusters, --long options with int, double and string values and
+// positionals in between. Returns argc.
+static int make_argv(int num_defs, const char **argv, char *cluster,
+                     char (*longs)[24]) {
+  int argc = 0;
+  argv[argc++] = "seargs_bench";
+
+  int num_short = (int)sizeof(short_names) - 1;
+  int n = 0;
+  cluster[n++] = '-';
+  for (int i = 0; i < num_defs && i < num_short && n < 8; i += 4) {
+    cluster[n++] = short_names[i];
+  }
+  cluster[n] = '\0';
+  if (n > 1) {
+    argv[argc++] = cluster;
+  }
+
+  int used = 0;
+  int step = num_defs / 64 > 0 ? num_defs / 64 : 1;
+  for (int i = 1; i < num_defs && used < 64; i += step, used++) {
+    snprintf(longs[used], sizeof(longs[used]), "--option-%d", i);
+    argv[argc++] = longs[used];
+    switch (i % 4) {
+    case 1:
+      argv[argc++] = "12345";
+      break;
+    case 2:
+      argv[argc++] = "3.14159";
+      break;
+    case 3:
+      argv[argc++] = "/some/path/to/a/file.txt";
+      break;
+    default:
+      break;
+    }
+    if (used % 8 == 0) {
+      argv[argc++] = "positional";
+    }
+  }
+  return argc;
+}
+
+/* ------- */
+/* Runner  */
+/* ------- */
+
+typedef struct {
+  uint64_t ns;
+  size_t allocs;
+  size_t peak;
+} phase_t;
+
+static void report(const char *name, int num_defs, int tokens, int iterations,
+                   const phase_t *phase) {
+  double seconds = phase->ns / 1e9;
+  printf("{\"case\":\"%s\",\"defs\":%d,\"tokens\":%d,\"iterations\":%d,"
+         "\"ops_per_sec\":%.1f,\"ns_per_op\":%.1f,\"ns_per_token\":%.2f,"
+         "\"mallocs_per_op\":%.2f,\"peak_bytes\":%zu}\n",
+         name, num_defs, tokens, iterations,
+         seconds > 0 ? iterations / seconds : 0.0,
+         (double)phase->ns / iterations,
+         tokens > 0 ? (double)phase->ns / iterations / tokens : 0.0,
+         (double)phase->allocs / iterations, phase->peak);
+}
+
+// Starts measuring a phase, the allocation counters are relative to here
+static uint64_t phase_begin(size_t *allocs_before) {
+  *allocs_before = alloc_count;
+  phase_base_bytes = live_bytes;
+  peak_bytes = live_bytes;
+  return now_ns();
+}
+
+static void phase_end(phase_t *phase, uint64_t start, size_t allocs_before) {
+  phase->ns += now_ns() - start;
+  phase->allocs += alloc_count - allocs_before;
+  // only what the phase allocated itself, not the workload or other parsers
+  if (peak_bytes - phase_base_bytes > phase->peak) {
+    phase->peak = peak_bytes - phase_base_bytes;
+  }
+}
+
+static void run(int num_defs, int scale) {
+  char(*names)[24] = malloc(num_defs * sizeof(*names));
+  arg_def_t *defs = make_defs(num_defs, names);
+  const char *argv[256];
+  char cluster[16];
+  char longs[64][24];
+  int argc = make_argv(num_defs, argv, cluster, longs);
+  int tokens = argc - 1;
+  int iterations = (int)(2000000 / (num_defs + tokens)) * scale;
+  if (iterations < 10) {
+    iterations = 10;
+  }
+
+  // parse_args(), the getters and free_parser() over the whole spec
+  phase_t parse = {0}, get = {0}, release = {0};
+  volatile double sink = 0;
+  for (int it = 0; it < iterations; it++) {
+    size_t allocs;
+    uint64_t start = phase_begin(&allocs);
+    parser_t *parser = parse_args(argc, argv, defs, num_defs);
+    phase_end(&parse, start, allocs);
+    if (!parser) {
+      fprintf(stderr, "parse failed for %d defs\n", num_defs);
+      exit(1);
+    }
+
+    start = phase_begin(&allocs);
+    for (int i = 0; i < num_defs; i++) {
+      switch (i % 4) {
+      case 0:
+        sink += GET_FLAG_ARG(parser, names[i]);
+        break;
+      case 1:
+        sink += GET_INT_ARG(parser, names[i]);
+        break;
+      case 2:
+        sink += GET_DOUBLE_ARG(parser, names[i]);
+        break;
+      default:
+        sink += GET_STRING_ARG(parser, names[i])[0];
+        break;
+      }
+    }
+    phase_end(&get, start, allocs);
+
+    start = phase_begin(&allocs);
+    free_parser(&parser);
+    phase_end(&release, start, allocs);
+  }
+  report("parse_args", num_defs, tokens, iterations, &parse);
+  report("getters", num_defs, num_defs, iterations, &get);
+  report("free_parser", num_defs, tokens, iterations, &release);
+
+  // compiled spec, a fresh parser per command line and one reused parser
+  seargs_spec_t *spec = seargs_compile(defs, num_defs);
+  phase_t fresh = {0}, reparse = {0};
+  for (int it = 0; it < iterations; it++) {
+    size_t allocs;
+    uint64_t start = phase_begin(&allocs);
+    parser_t *parser = seargs_parse(spec, argc, argv, SEARGS_DEFAULT);
+    bool parsed = parser != NULL;
+    free_parser(&parser);
+    phase_end(&fresh, start, allocs);
+    if (!parsed) {
+      fprintf(stderr, "seargs_parse failed for %d defs\n", num_defs);
+      exit(1);
+    }
+  }
+  parser_t *parser = seargs_new_parser(spec, SEARGS_DEFAULT);
+  for (int it = 0; it < iterations; it++) {
+    size_t allocs;
+    uint64_t start = phase_begin(&allocs);
+    seargs_err_codes err = seargs_reparse(parser, argc, argv);
+    phase_end(&reparse, start, allocs);
+    if (err != SEARGS_OK) {
+      fprintf(stderr, "reparse failed for %d defs\n", num_defs);
+      exit(1);
+    }
+  }
+
+  // the same command line as one string, tokenized in place every time so a
+  // fresh copy of it is part of each operation
+  char line[4096], work[4096];
+  size_t line_len = 0;
+  for (int i = 0; i < argc; i++) {
+    line_len += snprintf(line + line_len, sizeof(line) - line_len, "%s%s",
+                         i ? " " : "", argv[i]);
+  }
+  phase_t parse_line = {0};
+  for (int it = 0; it < iterations; it++) {
+    size_t allocs;
+    uint64_t start = phase_begin(&allocs);
+    memcpy(work, line, line_len + 1);
+    seargs_err_codes err = seargs_parse_line(parser, work);
+    phase_end(&parse_line, start, allocs);
+    if (err != SEARGS_OK) {
+      fprintf(stderr, "line parse failed for %d defs\n", num_defs);
+      exit(1);
+    }
+  }
+  free_parser(&parser);
+  seargs_free_spec(&spec);
+  report("seargs_parse", num_defs, tokens, iterations, &fresh);
+  report("seargs_reparse", num_defs, tokens, iterations, &reparse);
+  report("seargs_parse_line", num_defs, tokens, iterations, &parse_line);
+
+  free(defs);
+  free(names);
+}
+
+int main(int argc, const char *argv[]) {
+  int scale = argc > 1 ? atoi(argv[1]) : 1;
+  if (scale < 1) {
+    scale = 1;
+  }
+  const int sizes[] = {10, 100, 500, 1000, 5000};
+  for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+    run(sizes[i], scale);
+  }
+  return 0;
+}
@@ -1,370 +1,2483 @@
 
+// mmap() and friends for response files
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include "seargs.h"
 #include <errno.h>
 #include <float.h>
 #include <limits.h>
+#include <math.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#if defined(SEARGS_STATS) && defined(_WIN32)
+#include <windows.h>
+#elif defined(SEARGS_STATS)
+#include <time.h>
+#endif
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(_WIN32)
+#define environ _environ
+#else
+extern char **environ;
+#endif
+
+// parse_args_into() rounds the callers buffer up to this alignment
+#define SEARGS_BUF_ALIGN 16
+// Alignment of list values in the arena and the smallest heap chunk and list
+// capacity to allocate
+#define SEARGS_ARENA_ALIGN 8
+#define SEARGS_MIN_CHUNK 1024
+#define SEARGS_MIN_LIST 8
+// Significant digits parse_double_() hands to strtod() at most
+#define SEARGS_MAX_DIGITS 800
+// How deep response files may include other response files
+#define SEARGS_MAX_RESPONSE_DEPTH 16
+
 /* ------------------ */
 /* Utility functions. */
 /* ------------------ */
 
-static char *str_dup(const char *string) {
-  size_t len = strlen(string) + 1;
-  char *copy = malloc(len);
-  return copy ? memcpy(copy, string, len) : NULL;
+// Statistics (SEARGS_STATS), all of this compiles to nothing without them
+#if defined(SEARGS_STATS)
+#define STAT_ADD_(parser, field, n) ((parser)->stats.field += (n))
+#define STAT_PTR_(parser, field) (&(parser)->stats.field)
+#define PHASE_BEGIN_(start) uint64_t start = now_ns_()
+#define PHASE_END_(parser, phase, start) end_phase_(parser, phase, start)
+
+static uint64_t now_ns_(void) {
+#if defined(_WIN32)
+  LARGE_INTEGER freq, count;
+  QueryPerformanceFrequency(&freq);
+  QueryPerformanceCounter(&count);
+  return (uint64_t)((double)count.QuadPart * 1e9 / (double)freq.QuadPart);
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+#endif
 }
 
-// tries to convert a str into an int, returns false on failure
-static inline bool str_to_int(const char *str, int *out) {
-  errno = 0;
-  char *endptr;
-  long result = strtol(str, &endptr, 0);
-  if (*endptr != '\0') {
-    return false;
+// Adds the time since start to the phase total and reports it to the hook
+static void end_phase_(parser_t *parser, seargs_phase_t phase,
+                       uint64_t start) {
+  uint64_t ns = now_ns_() - start;
+  switch (phase) {
+  case SEARGS_PHASE_VALIDATE:
+    parser->stats.validate_ns += ns;
+    break;
+  case SEARGS_PHASE_PARSE:
+    parser->stats.parse_ns += ns;
+    break;
+  case SEARGS_PHASE_DEFAULTS:
+    parser->stats.defaults_ns += ns;
+    break;
   }
-  if (errno == ERANGE || result < INT_MIN || result > INT_MAX) {
+  if (parser->phase_hook) {
+    parser->phase_hook(parser->phase_hook_ctx, phase, ns, &parser->stats);
+  }
+}
+#else
+#define STAT_ADD_(parser, field, n) ((void)0)
+#define STAT_PTR_(parser, field) NULL
+#define PHASE_BEGIN_(start) ((void)0)
+#define PHASE_END_(parser, phase, start) ((void)0)
+#endif
+
+/* ------------------- */
+/* Numeric conversion. */
+/* ------------------- */
+
+// None of these depend on the locale or touch errno. Whitespace is not skipped
+// and the str_to_* functions need the whole string to be a number.
+
+// Exact powers of ten, every one of them is representable as a double
+static const double pow10_[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                1e12, 1e13, 1e14, 1e15, 1e16, 1e17,
+                                1e18, 1e19, 1e20, 1e21, 1e22};
+
+#define SWAR_ONES_ 0x0101010101010101ULL
+#define SWAR_HIGHS_ 0x8080808080808080ULL
+
+// Converts the 8 chars at p into *out if they all are decimal digits. Pairs of
+// digits, then pairs of pairs and then the two halves are combined with one
+// multiplication each, which needs the first char in the low byte of the word
+// so big endian targets always take the bytewise path.
+static inline bool digits8_(const char *p, uint64_t *out) {
+#if (defined(__BYTE_ORDER__) &&                                                \
+     __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__) ||                             \
+    defined(_M_X64) || defined(_M_IX86) || defined(_M_ARM64)
+  uint64_t x;
+  memcpy(&x, p, sizeof(x));
+  // '0'..'9' are 0x30..0x39, adding 6 keeps those within 0x3f
+  if (((x & 0xF0F0F0F0F0F0F0F0ULL) |
+       (((x + SWAR_ONES_ * 6) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) !=
+      SWAR_ONES_ * 0x33) {
     return false;
   }
-  *out = (int)result;
+  x = ((x & 0x0F0F0F0F0F0F0F0FULL) * 2561) >> 8;
+  x = ((x & 0x00FF00FF00FF00FFULL) * 6553601) >> 16;
+  *out = ((x & 0x0000FFFF0000FFFFULL) * 42949672960001ULL) >> 32;
   return true;
+#else
+  (void)p;
+  (void)out;
+  return false;
+#endif
 }
 
-// tries to convert a str into a double, returns false on failure
-static inline bool str_to_double(const char *str, double *out) {
-  errno = 0;
-  char *endptr;
-  double result = strtod(str, &endptr);
-  if (*endptr != '\0') {
-    return false;
+// Parses an unsigned integer at *str, with a 0x prefix for hex and a leading 0
+// for octal like strtoull() with base 0. *str is moved past the digits. When
+// limit is not NULL the bytes up to it may be read ahead, which lets decimal
+// digits be converted 8 at a time. Returns false if there are no digits or
+// the value does not fit in 64 bits.
+static bool parse_u64_(const char **str, const char *limit, uint64_t *out) {
+  const char *s = *str;
+  unsigned base = 10;
+  if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+    base = 16;
+    s += 2;
+  } else if (s[0] == '0') {
+    base = 8;
+  }
+  const char *digits = s;
+  uint64_t value = 0;
+  uint64_t chunk;
+  // 10^8 * value + chunk cannot overflow below this
+  while (base == 10 && limit && limit - s >= 8 &&
+         value <= (UINT64_MAX - 99999999) / 100000000 &&
+         digits8_(s, &chunk)) {
+    value = value * 100000000 + chunk;
+    s += 8;
+  }
+  for (;; s++) {
+    unsigned digit;
+    if (*s >= '0' && *s <= '9') {
+      digit = *s - '0';
+    } else if (*s >= 'a' && *s <= 'f') {
+      digit = *s - 'a' + 10;
+    } else if (*s >= 'A' && *s <= 'F') {
+      digit = *s - 'A' + 10;
+    } else {
+      break;
+    }
+    if (digit >= base) {
+      break;
+    }
+    if (value > (UINT64_MAX - digit) / base) {
+      return false;
+    }
+    value = value * base + digit;
   }
-  if (errno == ERANGE || result > DBL_MAX) {
+  if (s == digits) {
     return false;
   }
-  *out = result;
+  *str = s;
+  *out = value;
   return true;
 }
 
-// Internal helper to free the strings allocated by strdup() in parse_args()
-// properly
-static inline void _cleanup_string_states(const arg_def_t *defs,
-                                          arg_state_t *states, int limit) {
-  if (!states || !defs)
-    return;
-  for (int i = 0; i < limit; i++) {
-    if (defs[i].type == ARG_STRING && states[i].string_allocated) {
-      free(states[i].value.string_val);
-    }
+// Same as parse_u64_() with an optional sign, the value has to fit an int64_t
+static bool parse_i64_(const char **str, const char *limit, int64_t *out) {
+  const char *s = *str;
+  bool negative = *s == '-';
+  if (*s == '-' || *s == '+') {
+    s++;
+  }
+  uint64_t magnitude;
+  if (!parse_u64_(&s, limit, &magnitude)) {
+    return false;
+  }
+  if (magnitude > (uint64_t)INT64_MAX + negative) {
+    return false;
+  }
+  if (negative) {
+    *out = magnitude == (uint64_t)INT64_MAX + 1 ? INT64_MIN
+                                                : -(int64_t)magnitude;
+  } else {
+    *out = (int64_t)magnitude;
   }
+  *str = s;
+  return true;
 }
 
-// Internal helper to do a full cleanup of memory even if it wasnt fully
-// initialized yet.
-static inline void _cleanup_parser(parser_t *parser) {
-  if (!parser) {
-    return;
+// tries to convert a str into an int, returns false on failure
+static inline bool str_to_int(const char *str, int *out) {
+  int64_t result;
+  if (!parse_i64_(&str, NULL, &result) || *str != '\0') {
+    return false;
   }
-  if (parser->states) {
-    _cleanup_string_states(parser->defs, parser->states, parser->num_args);
+  if (result < INT_MIN || result > INT_MAX) {
+    return false;
   }
-  free(parser);
+  *out = (int)result;
+  return true;
 }
 
-// Helper for parse_args() to properly cleanup on failure
-static parser_t *failure(parser_t *parser, const char *msg, const char *arg,
-                         seargs_err_codes err_code) {
-  if (msg) {
-    fprintf(stderr, "%s%s%s\n", msg, arg ? ": " : "", arg ? arg : "");
-  }
-  parser->error =
-      (seargs_error_t){.msg = msg, .arg_name = arg, .code = err_code};
-  return NULL;
+// tries to convert a str into an int64_t, returns false on failure
+static inline bool str_to_int64(const char *str, int64_t *out) {
+  return parse_i64_(&str, NULL, out) && *str == '\0';
 }
 
-static parser_t *fatal_failure(parser_t *parser, const char *msg) {
-  if (msg) {
-    fprintf(stderr, "%s\n", msg);
+// tries to convert a str into an uint64_t, returns false on failure
+static inline bool str_to_uint64(const char *str, uint64_t *out) {
+  if (*str == '+') {
+    str++;
   }
-  _cleanup_parser(parser);
-  return NULL;
+  return parse_u64_(&str, NULL, out) && *str == '\0';
 }
 
-bool validate_arg_defs(const arg_def_t *defs, int num_args) {
-  if (!defs || num_args <= 0)
+// tries to convert a size like 512, 64K, 2Gi or 1TiB into a byte count,
+// returns false on failure. K/M/G/T are powers of 1000 and Ki/Mi/Gi/Ti powers
+// of 1024, in either case, a trailing B is allowed.
+static inline bool str_to_size(const char *str, uint64_t *out) {
+  if (*str == '+') {
+    str++;
+  }
+  uint64_t value;
+  if (!parse_u64_(&str, NULL, &value)) {
     return false;
-
-  for (int i = 0; i < num_args; i++) {
-    if (!defs[i].name) {
-      fprintf(stderr, "Argument name cannot be null\n");
-      return false;
-    }
-    for (int i = 0; i < num_args; i++) {
-      if (contains_format_specifier(defs[i].name) ||
-          contains_format_specifier(defs[i].desc)) {
-        fprintf(
-            stderr,
-            "Argument name/description contains invalid format specifier: %s\n",
-            defs[i].name);
-        return false;
-      }
-    }
-    for (int j = i + 1; j < num_args; j++) {
-      if (!defs[j].name) {
-        fprintf(stderr, "Argument name cannot be null\n");
-        return false;
-      }
-      if (strcmp(defs[i].name, defs[j].name) == 0) {
-        fprintf(stderr, "Duplicate argument name: %s\n", defs[i].name);
-        return false;
-      }
-      if (defs[i].short_name == defs[j].short_name) {
-        fprintf(stderr, "Duplicate short name: %c\n", defs[i].short_name);
-        return false;
-      }
+  }
+  int power = 0;
+  switch (*str) {
+  case 'k':
+  case 'K':
+    power = 1;
+    break;
+  case 'm':
+  case 'M':
+    power = 2;
+    break;
+  case 'g':
+  case 'G':
+    power = 3;
+    break;
+  case 't':
+  case 'T':
+    power = 4;
+    break;
+  default:
+    break;
+  }
+  uint64_t multiplier = 1;
+  if (power) {
+    uint64_t unit = *++str == 'i' ? 1024 : 1000;
+    str += unit == 1024;
+    while (power--) {
+      multiplier *= unit;
     }
   }
+  if (*str == 'B') {
+    str++;
+  }
+  if (*str != '\0' || value > UINT64_MAX / multiplier) {
+    return false;
+  }
+  *out = value * multiplier;
   return true;
 }
 
-void print_help(const arg_def_t *defs, int num_args) {
-  if (!defs || num_args <= 0)
-    return;
-  int max_name_len = 0;
-  for (int i = 0; i < num_args; i++) {
-    int current_len = strlen(defs[i].name);
-    if (current_len > max_name_len) {
-      max_name_len = current_len;
-    }
+// Parses a decimal number at *str into a double and moves *str past it, see
+// parse_u64_() for limit. Values with at most 19 significant digits and a
+// small exponent are computed exactly from a single multiplication or
+// division, others are handed to strtod() rewritten as digits and an exponent
+// without a radix char so the locale cannot change the result. Both round
+// correctly. Rejects infinities and values that overflow or underflow to zero.
+static bool parse_double_(const char **str, const char *limit, double *out) {
+  const char *s = *str;
+  bool negative = *s == '-';
+  if (*s == '-' || *s == '+') {
+    s++;
   }
-  int total_pad_width = max_name_len + 5;
-  printf("Usage:\n");
-  for (int i = 0; i < num_args; i++) {
-    char short_name_part[6];
-    if (defs[i].short_name) {
-      snprintf(short_name_part, sizeof(short_name_part), "(-%c)",
-               defs[i].short_name);
-    } else {
-      snprintf(short_name_part, sizeof(short_name_part), "    ");
-    }
-    printf("  --%s %-*s  %s\n", defs[i].name,
-           (int)(total_pad_width - strlen(defs[i].name)), short_name_part,
-           defs[i].desc);
+  if ((s[0] | 0x20) == 'n' && (s[1] | 0x20) == 'a' && (s[2] | 0x20) == 'n') {
+    *out = negative ? -NAN : NAN;
+    *str = s + 3;
+    return true;
   }
-}
 
-const arg_def_t *get_matching_arg_def_(const char *name, const arg_def_t *defs,
-                                      int num_args, bool is_short_name) {
-  if (!defs || num_args <= 0 || !name) {
-    return NULL;
+  const char *mantissa_start = s;
+  uint64_t mantissa = 0;
+  int significant = 0;
+  long exp10 = 0;
+  bool seen_digit = false;
+  bool seen_point = false;
+  bool truncated = false;
+  uint64_t chunk;
+  for (;; s++) {
+    if (*s == '.' && !seen_point) {
+      seen_point = true;
+      continue;
+    }
+    // past the leading zeros 8 digits at a time while they stay significant
+    if (significant > 0 && significant <= 11 && limit && limit - s >= 8 &&
+        digits8_(s, &chunk)) {
+      mantissa = mantissa * 100000000 + chunk;
+      significant += 8;
+      exp10 -= 8 * seen_point;
+      s += 7;
+      continue;
+    }
+    if (*s < '0' || *s > '9') {
+      break;
+    }
+    seen_digit = true;
+    unsigned digit = *s - '0';
+    if (significant == 0 && digit == 0) {
+      exp10 -= seen_point; // leading zeros only shift the exponent
+    } else if (significant < 19) {
+      mantissa = mantissa * 10 + digit;
+      significant++;
+      exp10 -= seen_point;
+    } else {
+      truncated |= digit != 0;
+      exp10 += !seen_point;
+    }
   }
-  if (is_short_name && strlen(name) > 1) {
-    return NULL;
+  if (!seen_digit) {
+    return false;
   }
-  if (!is_short_name) {
-    for (int i = 0; i < num_args; i++) {
-      if (strcmp(defs[i].name, name) == 0) {
-        return &defs[i];
+  const char *mantissa_end = s;
+  long exponent = 0;
+  if (*s == 'e' || *s == 'E') {
+    s++;
+    bool negative_exp = *s == '-';
+    if (*s == '-' || *s == '+') {
+      s++;
+    }
+    if (*s < '0' || *s > '9') {
+      return false;
+    }
+    for (; *s >= '0' && *s <= '9'; s++) {
+      if (exponent < 100000) { // anything past this is 0 or inf anyway
+        exponent = exponent * 10 + (*s - '0');
       }
     }
-    return NULL;
+    exponent = negative_exp ? -exponent : exponent;
   }
-  if (is_short_name) {
-    for (int i = 0; i < num_args; i++) {
-      if (defs[i].short_name == name[0]) {
-        return &defs[i];
+  exp10 += exponent;
+
+  double result;
+  if (mantissa == 0) {
+    result = 0.0;
+  } else if (!truncated && mantissa <= (1ULL << 53) && exp10 >= -22 &&
+             exp10 <= 22) {
+    result = (double)mantissa;
+    result = exp10 < 0 ? result / pow10_[-exp10] : result * pow10_[exp10];
+  } else {
+    // 800 significant digits plus a sticky digit are enough to round right
+    char digits[SEARGS_MAX_DIGITS + 32];
+    int n = 0;
+    long digits_exp = exponent;
+    bool sticky = false;
+    bool after_point = false;
+    for (const char *c = mantissa_start; c < mantissa_end; c++) {
+      if (*c == '.') {
+        after_point = true;
+        continue;
+      }
+      if (n == 0 && *c == '0') {
+        digits_exp -= after_point;
+      } else if (n < SEARGS_MAX_DIGITS) {
+        digits[n++] = *c;
+        digits_exp -= after_point;
+      } else {
+        sticky |= *c != '0';
+        digits_exp += !after_point;
       }
     }
-    return NULL;
+    if (sticky) {
+      digits[n++] = '1';
+      digits_exp--;
+    }
+    snprintf(digits + n, sizeof(digits) - n, "e%ld", digits_exp);
+    int saved_errno = errno; // parsing leaves errno alone, strtod() may not
+    result = strtod(digits, NULL);
+    errno = saved_errno;
+    if (result > DBL_MAX || result == 0.0) {
+      return false;
+    }
   }
-  return NULL;
+  *out = negative ? -result : result;
+  *str = s;
+  return true;
 }
 
-// (parser_t *) but only ever returns the parser you passed in or null for
-// error. that is return truthy value on success otherwise a falsy value.
-parser_t *assign_value(const arg_def_t *def, const char *argv[], int *i,
-                       int argc, parser_t *parser, arg_state_t *state) {
-  if (!state || !def) {
-    return NULL;
-  }
-  if (*i >= argc) {
-    return failure(parser, "Missing value for", def->name, MISSING_VALUE_ERR);
-  }
-  const char *arg = argv[*i];
-  state->found = true;
-  switch (def->type) {
-  case ARG_FLAG:
-    state->value.flag_val = true;
-    break;
+// tries to convert a decimal str into a double, returns false on failure
+static inline bool str_to_double(const char *str, double *out) {
+  return parse_double_(&str, NULL, out) && *str == '\0';
+}
+
+// Converts str into value for the numeric types and stores string types as
+// is, flags take no value. Returns NULL on success and the error message
+// otherwise.
+static const char *convert_value_(arg_type_t type, const char *str,
+                                  arg_val_t *value) {
+  switch (type) {
   case ARG_INT:
-    if (*i + 1 >= argc) {
-      return failure(parser, "Missing value for", arg, MISSING_VALUE_ERR);
-    }
-    if (!str_to_int(argv[++*i], &state->value.int_val)) {
-      return failure(parser, "Invalid value for (expected an integer)", arg,
-                     INVALID_VALUE_ERR);
-    }
-    break;
+  case ARG_INT_LIST:
+    return str_to_int(str, &value->int_val)
+               ? NULL
+               : "Invalid value for (expected an integer)";
   case ARG_DOUBLE:
-    if (*i + 1 >= argc) {
-      return failure(parser, "Missing value for", arg, MISSING_VALUE_ERR);
-    }
-    if (!str_to_double(argv[++*i], &state->value.double_val)) {
-      return failure(parser, "Invalid value for (expected float or double)",
-                     arg, INVALID_VALUE_ERR);
-    }
-    break;
+  case ARG_DOUBLE_LIST:
+    return str_to_double(str, &value->double_val)
+               ? NULL
+               : "Invalid value for (expected float or double)";
+  case ARG_INT64:
+    return str_to_int64(str, &value->int64_val)
+               ? NULL
+               : "Invalid value for (expected a 64-bit integer)";
+  case ARG_UINT64:
+    return str_to_uint64(str, &value->uint64_val)
+               ? NULL
+               : "Invalid value for (expected an unsigned 64-bit integer)";
+  case ARG_SIZE:
+    return str_to_size(str, &value->uint64_val)
+               ? NULL
+               : "Invalid value for (expected a size like 64K or 2Gi)";
   case ARG_STRING:
-    if (*i + 1 >= argc) {
-      return failure(parser, "Missing value for", arg, MISSING_VALUE_ERR);
-    }
-    state->value.string_val = str_dup(argv[++*i]);
-    if (!state->value.string_val) {
-      return fatal_failure(parser, "Failed to allocate memory");
-    }
-    state->string_allocated = true;
-    break;
-  default:
-    break;
+  case ARG_STRING_LIST:
+    value->string_val = (char *)str;
+    return NULL;
+  case ARG_INT_ARRAY:
+  case ARG_DOUBLE_ARRAY: // split by set_array_()
+  case ARG_FLAG:
+    return NULL;
   }
-  return parser;
+  return NULL;
 }
 
-// parses the provided arguments, checking validity and returning a pointer
-// to the parsed args. returns NULL on failure
-parser_t *parse_args(int argc, const char *argv[], const arg_def_t *args_defs,
-                     size_t num_args) {
-  if (!validate_arg_defs(args_defs, num_args)) {
-    return NULL;
+static inline void set_bit_(uint64_t *bits, int i) {
+  bits[i >> 6] |= 1ULL << (i & 63);
+}
+
+static inline void put_bit_(uint64_t *bits, int i, bool on) {
+  uint64_t mask = 1ULL << (i & 63);
+  bits[i >> 6] = (bits[i >> 6] & ~mask) | (on ? mask : 0);
+}
+
+// Index of the lowest set bit of a nonzero word
+static inline int lowest_bit_(uint64_t x) {
+#if defined(__GNUC__)
+  return __builtin_ctzll(x);
+#else
+  int i = 0;
+  for (; !(x & 1); x >>= 1) {
+    i++;
   }
+  return i;
+#endif
+}
 
-  if (argc <= 1) {
-    print_help(args_defs, num_args);
-    return NULL;
+// Types whose value is an arg_list_t, arrays are lists filled from one value
+static bool is_list_type_(arg_type_t type) {
+  return type == ARG_INT_LIST || type == ARG_DOUBLE_LIST ||
+         type == ARG_STRING_LIST || type == ARG_INT_ARRAY ||
+         type == ARG_DOUBLE_ARRAY;
+}
+
+// Bytes of one item of a list type
+static size_t list_item_size_(arg_type_t type) {
+  switch (type) {
+  case ARG_INT_LIST:
+  case ARG_INT_ARRAY:
+    return sizeof(int);
+  case ARG_DOUBLE_LIST:
+  case ARG_DOUBLE_ARRAY:
+    return sizeof(double);
+  default:
+    return sizeof(const char *);
   }
+}
 
-  // settings size of args as parser_t and states as num_args * arg_state_t in
-  // same variable for allowing pointer arithmetic
-  parser_t *parser =
-      calloc(1, sizeof(parser_t) + num_args * sizeof(arg_state_t));
-  if (!parser) {
-    return fatal_failure(parser, "Failed to allocate memory");
+// FNV-1a over the first len bytes of name
+static inline unsigned long hash_name_(const char *name, size_t len) {
+  unsigned long hash = 2166136261UL;
+  for (size_t i = 0; i < len; i++) {
+    hash ^= (unsigned char)name[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+// Size of the name index for num_args defs, a power of two with at least half
+// of the slots left empty so probe chains stay short
+static size_t name_index_cap_(size_t num_args) {
+  size_t cap = 8;
+  while (cap < num_args * 2) {
+    cap <<= 1;
   }
-  parser->defs = args_defs;
-  parser->states =
-      (arg_state_t *)(parser + 1); // args + 1 moves memory of args by parser_t
-                                   // meaning the remainder is for state
-  parser->num_args = num_args;
+  return cap;
+}
 
-  // main parse loop
-  for (int i = 1; i < argc; i++) {
-    const char *arg = argv[i];
-    if (strcmp(arg, "--") == 0) {
-      break;
-    }
-    if (arg[0] != '-') {
+// Key of a def in a name index, its long name or its environment variable
+static inline const char *index_key_(const arg_def_t *def, bool env) {
+  return env ? def->env : def->name;
+}
+
+// Fills a zeroed table of cap slots with def index + 1 for every def keyed by
+// its name (or env, skipping defs without one), returns the index of the
+// first def whose key is already taken or -1. Assumes no null names.
+static int build_name_index_(const arg_def_t *defs, int num_args, int *table,
+                             size_t cap, bool env) {
+  for (int i = 0; i < num_args; i++) {
+    const char *key = index_key_(&defs[i], env);
+    if (!key) {
       continue;
     }
-    if (arg[1] == '-') {
-      const arg_def_t *def =
-          get_matching_arg_def_(arg + 2, args_defs, num_args, false);
-      if (!def) {
-        return failure(parser, "Unknown argument", arg, UNKNOWN_ARG_ERR);
-      }
-      int def_index = def - args_defs;
-      arg_state_t *state = &parser->states[def_index];
-      if (!assign_value(def, argv, &i, argc, parser, state)) {
-        return NULL;
-      };
-    } else {
-      const char *arg_cluster = arg + 1;
-      if (arg_cluster[0] == '\0') {
-        return failure(parser, "Invalid short argument", arg, INVALID_ARG_ERR);
-      }
-      for (int j = 0; arg_cluster[j] != '\0'; j++) {
-        char short_char[2] = {arg_cluster[j], '\0'};
-        bool is_last = arg_cluster[j + 1] == '\0';
-        const arg_def_t *def =
-            get_matching_arg_def_(short_char, args_defs, num_args, true);
-        if (!def) {
-          return failure(parser, "Unknown argument", arg, UNKNOWN_ARG_ERR);
-        }
-        if (def->type != ARG_FLAG && !is_last) {
-          return failure(parser, "Non-flag argument must be last in cluster",
-                         arg, INVALID_ARG_ERR);
-        }
-        int def_index = def - args_defs;
-        arg_state_t *state = &parser->states[def_index];
-        if (!assign_value(def, argv, &i, argc, parser, state)) {
-          return NULL;
-        }
-        if (def->type != ARG_FLAG) {
-          break;
-        }
+    size_t slot = hash_name_(key, strlen(key)) & (cap - 1);
+    while (table[slot]) {
+      if (strcmp(index_key_(&defs[table[slot] - 1], env), key) == 0) {
+        return i;
       }
+      slot = (slot + 1) & (cap - 1);
     }
-    parser->pos_args = (i < argc) ? &argv[i] : NULL;
-    parser->num_pos_args = (i < argc) ? argc - i : 0;
+    table[slot] = i + 1;
   }
-  // loop to check argument requirements
-  for (int i = 0; i < num_args; i++) {
-    arg_state_t *state = &parser->states[i];
-    const arg_def_t *def = &parser->defs[i];
-    if (state->found) {
-      continue;
-    }
+  return -1;
+}
 
-    if (def->required) {
-      return failure(parser, "Missing required argument", def->name,
-                     MISSING_ARG_ERR);
+// Looks up the first len bytes of name in a name index built by
+// build_name_index_(), returns the def index or -1. Adds the number of names
+// compared to *compares unless it is NULL.
+static int find_in_index_(const arg_def_t *defs, const int *table, size_t cap,
+                          bool env, const char *name, size_t len,
+                          uint64_t *compares) {
+  size_t mask = cap - 1;
+  size_t slot = hash_name_(name, len) & mask;
+  int entry;
+  while ((entry = table[slot])) {
+    if (compares) {
+      ++*compares;
     }
+    const char *key = index_key_(&defs[entry - 1], env);
+    if (strncmp(key, name, len) == 0 && key[len] == '\0') {
+      return entry - 1;
+    }
+    slot = (slot + 1) & mask;
+  }
+  return -1;
+}
 
-    if (def->type == ARG_STRING && def->default_val.string_val) {
-      state->value.string_val = str_dup(def->default_val.string_val);
-      if (!state->value.string_val) {
-        return fatal_failure(parser, "Failed to allocate memory");
-      }
-      state->string_allocated = true;
-    } else {
-      state->value = def->default_val;
-      state->string_allocated = false;
+// Looks up the first len bytes of name in the specs name index, returns the
+// def index or -1
+static int find_long_index_(const seargs_spec_t *spec, const char *name,
+                            size_t len, uint64_t *compares) {
+  return find_in_index_(spec->defs, spec->name_index, spec->index_cap, false,
+                        name, len, compares);
+}
+
+// Fills a zeroed 256 entry table with def index + 1 keyed by short_name,
+// returns the index of the first def whose short_name is already taken or -1.
+// defs without a short_name (0) are skipped.
+static int build_short_index_(const arg_def_t *defs, int num_args,
+                              int table[256]) {
+  for (int i = 0; i < num_args; i++) {
+    unsigned char c = (unsigned char)defs[i].short_name;
+    if (!c) {
+      continue;
+    }
+    if (table[c]) {
+      return i;
     }
+    table[c] = i + 1;
   }
-  return parser;
+  return -1;
 }
 
-// Free all arguments after use.
+/* --------------- */
+/* Response files. */
+/* --------------- */
 
-void free_parser(parser_t **p_parser) {
-  if (!p_parser || !*p_parser)
-    return;
-  _cleanup_parser(*p_parser);
-  *p_parser = NULL;
+static inline bool is_space_(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' ||
+         c == '\f';
 }
 
-void *get_arg_val(parser_t *parser, const char *name) {
-  if (!parser) {
-    return NULL;
+// Bytes next_token_() has to look at: whitespace, quotes and backslashes
+// outside quotes, the closing quote (and backslashes for ") inside them
+static inline bool is_special_(char c, char quote) {
+  if (quote) {
+    return c == quote || (quote == '"' && c == '\\');
   }
-  for (int i = 0; i < parser->num_args; i++) {
-    if (strcmp(parser->defs[i].name, name) == 0) {
-      arg_state_t *state = &parser->states[i];
-      switch (parser->defs[i].type) {
-      case ARG_FLAG:
-        return &state->value.flag_val;
-      case ARG_INT:
-        return &state->value.int_val;
-      case ARG_DOUBLE:
-        return &state->value.double_val;
-      case ARG_STRING:
-        return &state->value.string_val;
+  return is_space_(c) || c == '\'' || c == '"' || c == '\\';
+}
+
+// High bit set in the bytes of x equal to c (and maybe in bytes above those)
+static inline uint64_t swar_eq_(uint64_t x, unsigned char c) {
+  uint64_t y = x ^ (SWAR_ONES_ * c);
+  return (y - SWAR_ONES_) & ~y & SWAR_HIGHS_;
+}
+
+// Length of the run of bytes at p that next_token_() copies as they are. Eight
+// bytes are checked at once, a word is only scanned bytewise when it may hold
+// a special byte, so long tokens cost about as much as a memchr().
+static size_t plain_run_(const char *p, const char *end, char quote) {
+  const char *start = p;
+  while (end - p >= 8) {
+    uint64_t x;
+    memcpy(&x, p, sizeof(x));
+    uint64_t special;
+    if (quote) {
+      special = swar_eq_(x, quote) | (quote == '"' ? swar_eq_(x, '\\') : 0);
+    } else {
+      // bytes below 14 cover \t to \r, the few false positives are sorted out
+      // below
+      special = ((x - SWAR_ONES_ * 14) & ~x & SWAR_HIGHS_) | swar_eq_(x, ' ') |
+                swar_eq_(x, '\'') | swar_eq_(x, '"') | swar_eq_(x, '\\');
+    }
+    if (special) {
+      for (int i = 0; i < 8; i++) {
+        if (is_special_(p[i], quote)) {
+          return p + i - start;
+        }
+      }
+    }
+    p += 8;
+  }
+  while (p < end && !is_special_(*p, quote)) {
+    p++;
+  }
+  return p - start;
+}
+
+// Splits the next whitespace separated token out of [*cursor, end) in place.
+// '...' is taken literally, "..." allows \" and \\ escapes and outside quotes
+// a backslash escapes the next char. Unquoting only ever shrinks a token so it
+// is NUL terminated at or before the delimiter that ended it, *end must be
+// writable for a token running up to the end. Returns NULL once no tokens are
+// left, with *unterminated set if that is because of an open quote.
+static char *next_token_(char **cursor, char *end, bool *unterminated) {
+  char *r = *cursor;
+  while (r < end && is_space_(*r)) {
+    r++;
+  }
+  if (r >= end) {
+    *cursor = r;
+    return NULL;
+  }
+  char *token = r;
+  char *w = r;
+  char quote = 0;
+  while (r < end) {
+    // copy ordinary bytes in bulk, they only move once a quote or escape
+    // has been dropped
+    size_t n = plain_run_(r, end, quote);
+    if (w != r) {
+      memmove(w, r, n);
+    }
+    w += n;
+    r += n;
+    if (r >= end) {
+      break;
+    }
+    char c = *r++;
+    if (quote) {
+      if (c == quote) {
+        quote = 0;
+        continue;
+      }
+      if (r < end && (*r == '"' || *r == '\\')) { // only \ gets here
+        c = *r++;
+      }
+    } else if (is_space_(c)) {
+      r--;
+      break;
+    } else if (c == '\'' || c == '"') {
+      quote = c;
+      continue;
+    } else if (c == '\\' && r < end) {
+      c = *r++;
+    }
+    *w++ = c;
+  }
+  if (quote) {
+    *unterminated = true;
+    return NULL;
+  }
+  *cursor = r < end ? r + 1 : r;
+  *w = '\0';
+  return token;
+}
+
+// Reads a whole file into a writable buffer with a NUL after the contents.
+// Files are mapped privately (copy on write) so tokenizing them in place does
+// not copy anything, unless their size is a multiple of the page size in which
+// case there would be no room for the trailing NUL and the file is read into
+// the heap instead.
+static bool read_file_(const char *path, seargs_file_t *file) {
+  *file = (seargs_file_t){0};
+#if !defined(_WIN32)
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+    close(fd);
+    return false;
+  }
+  file->size = (size_t)st.st_size;
+  long page = sysconf(_SC_PAGESIZE);
+  if (file->size == 0) {
+    close(fd);
+    return true;
+  }
+  if (page > 0 && file->size % (size_t)page != 0) {
+    void *data = mmap(NULL, file->size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+                      fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+      return false;
+    }
+    file->data = data;
+    file->mapped = true;
+    return true;
+  }
+  close(fd);
+#endif
+  FILE *fp = fopen(path, "rb");
+  if (!fp) {
+    return false;
+  }
+  if (fseek(fp, 0, SEEK_END) != 0) {
+    fclose(fp);
+    return false;
+  }
+  long size = ftell(fp);
+  rewind(fp);
+  file->data = size >= 0 ? malloc((size_t)size + 1) : NULL;
+  if (!file->data || fread(file->data, 1, (size_t)size, fp) != (size_t)size) {
+    fclose(fp);
+    free(file->data);
+    file->data = NULL;
+    return false;
+  }
+  fclose(fp);
+  file->size = (size_t)size;
+  file->data[file->size] = '\0';
+  return true;
+}
+
+// read_file_() without changing errno, failures are reported by the caller
+static bool load_file_(const char *path, seargs_file_t *file) {
+  int saved_errno = errno;
+  bool loaded = read_file_(path, file);
+  errno = saved_errno;
+  return loaded;
+}
+
+static void unload_file_(seargs_file_t *file) {
+#if !defined(_WIN32)
+  if (file->mapped) {
+    munmap(file->data, file->size);
+    return;
+  }
+#endif
+  free(file->data);
+}
+
+// Unloads every response file of the parser, the token vector is kept for
+// reuse
+static void release_response_files_(parser_t *parser) {
+  for (int i = 0; i < parser->num_files; i++) {
+    unload_file_(&parser->files[i]);
+  }
+  parser->num_files = 0;
+  parser->num_tokens = 0;
+}
+
+/* ------- */
+/* Arenas. */
+/* ------- */
+
+// Heap block backing the arena of a parser that is not in caller storage, the
+// arena memory follows the header
+typedef union seargs_chunk {
+  union seargs_chunk *next;
+  double align_;
+} seargs_chunk_t;
+
+static void free_chunks_(parser_t *parser) {
+  seargs_chunk_t *chunk = parser->chunks;
+  while (chunk) {
+    seargs_chunk_t *next = chunk->next;
+    free(chunk);
+    chunk = next;
+  }
+  parser->chunks = NULL;
+}
+
+// Carves size bytes aligned to align (a power of two) out of the parsers
+// arena. Parsers in caller storage (parse_args_into()) cannot go past it,
+// others chain a bigger heap chunk and become the arena. seargs_reset() merges
+// the chunks into one that fits everything. Returns NULL when out of memory.
+static void *arena_alloc_(parser_t *parser, size_t size, size_t align) {
+  uintptr_t base = (uintptr_t)parser->arena;
+  size_t offset = ((base + parser->arena_used + align - 1) & ~(align - 1)) -
+                  base;
+  parser->arena_wanted += size + align - 1;
+  if (!parser->arena || offset + size > parser->arena_size) {
+    if (parser->external) {
+      return NULL;
+    }
+    size_t chunk_size = parser->arena_size * 2;
+    if (chunk_size < size + align) {
+      chunk_size = size + align;
+    }
+    if (chunk_size < SEARGS_MIN_CHUNK) {
+      chunk_size = SEARGS_MIN_CHUNK;
+    }
+    seargs_chunk_t *chunk = malloc(sizeof(seargs_chunk_t) + chunk_size);
+    if (!chunk) {
+      return NULL;
+    }
+    STAT_ADD_(parser, allocations, 1);
+    chunk->next = parser->chunks;
+    parser->chunks = chunk;
+    parser->arena = (char *)(chunk + 1);
+    parser->arena_size = chunk_size;
+    base = (uintptr_t)parser->arena;
+    offset = ((base + align - 1) & ~(align - 1)) - base;
+  }
+  parser->arena_used = offset + size;
+  return parser->arena + offset;
+}
+
+// Copies a string into the parsers arena, returns NULL when out of space
+static char *copy_string_(parser_t *parser, const char *string) {
+  size_t len = strlen(string) + 1;
+  char *copy = arena_alloc_(parser, len, 1);
+  STAT_ADD_(parser, bytes_copied, copy ? len : 0);
+  return copy ? memcpy(copy, string, len) : NULL;
+}
+
+// Makes room for n more items in the list value of arg i, growing it
+// geometrically. The list grows in place while it is the last thing in the
+// arena. Returns the list or NULL when out of memory.
+static arg_list_t *list_reserve_(parser_t *parser, int i, size_t n,
+                                 size_t item_size) {
+  arg_list_t *list = parser->values[i].list_val;
+  size_t count = list ? list->count : 0;
+  if (list && (size_t)list->capacity - count >= n) {
+    return list;
+  }
+  if (count + n > INT_MAX / 2) {
+    return NULL;
+  }
+  int capacity = list ? list->capacity * 2 : SEARGS_MIN_LIST;
+  while ((size_t)capacity < count + n) {
+    capacity *= 2;
+  }
+  size_t bytes = sizeof(arg_list_t) + capacity * item_size;
+  char *list_end =
+      list ? (char *)(list + 1) + list->capacity * item_size : NULL;
+  size_t extra = (capacity - (list ? list->capacity : 0)) * item_size;
+  if (list && list_end == parser->arena + parser->arena_used &&
+      extra <= parser->arena_size - parser->arena_used) {
+    parser->arena_used += extra;
+    parser->arena_wanted += extra;
+    list->capacity = capacity;
+    return list;
+  }
+  arg_list_t *grown = arena_alloc_(parser, bytes, SEARGS_ARENA_ALIGN);
+  if (!grown) {
+    return NULL;
+  }
+  grown->count = (int)count;
+  grown->capacity = capacity;
+  if (list) {
+    memcpy(grown + 1, list + 1, count * item_size);
+  }
+  parser->values[i].list_val = grown;
+  set_bit_(parser->allocated, i);
+  return grown;
+}
+
+// Appends an item to the list value of arg i
+static bool list_push_(parser_t *parser, int i, const void *item,
+                       size_t item_size) {
+  arg_list_t *list = list_reserve_(parser, i, 1, item_size);
+  if (!list) {
+    return false;
+  }
+  memcpy((char *)(list + 1) + list->count++ * item_size, item, item_size);
+  return true;
+}
+
+// Internal helper to do a full cleanup of memory even if it wasnt fully
+// initialized yet.
+static inline void _cleanup_parser(parser_t *parser) {
+  if (!parser) {
+    return;
+  }
+  _cleanup_parser(parser->sub);
+  release_response_files_(parser);
+  free(parser->files);
+  free(parser->tokens);
+  free_chunks_(parser);
+  if (!parser->external) {
+    free(parser);
+  }
+}
+
+// Same as failure() for the element (starting at 1) of an array value
+static parser_t *failure_at_(parser_t *parser, const char *msg,
+                             const char *arg, seargs_err_codes err_code,
+                             int element) {
+  parser->error = (seargs_error_t){
+      .msg = msg, .arg_name = arg, .code = err_code, .element = element};
+  // failures while applying the config file point at the offending line
+  if (parser->config_line) {
+    parser->error.file = parser->config;
+    parser->error.line = parser->config_line;
+  }
+  if (msg) {
+    if (parser->error.file) {
+      fprintf(stderr, "%s:%d: ", parser->error.file, parser->error.line);
+    }
+    fprintf(stderr, "%s%s%s", msg, arg ? ": " : "", arg ? arg : "");
+    if (element) {
+      fprintf(stderr, " (element %d)", element);
+    }
+    fprintf(stderr, "\n");
+  }
+  return NULL;
+}
+
+// Helper for parse_args() to properly cleanup on failure
+static parser_t *failure(parser_t *parser, const char *msg, const char *arg,
+                         seargs_err_codes err_code) {
+  return failure_at_(parser, msg, arg, err_code, 0);
+}
+
+// Helper for unrecoverable failures, parse_args() and friends free the parser
+// while seargs_reparse() and the like return OUT_OF_MEMORY_ERR
+static parser_t *fatal_failure(parser_t *parser, const char *msg) {
+  if (parser) {
+    parser->error = (seargs_error_t){.code = OUT_OF_MEMORY_ERR, .msg = msg};
+  }
+  if (msg) {
+    fprintf(stderr, "%s\n", msg);
+  }
+  return NULL;
+}
+
+// Bytes needed for a compiled spec of num_args defs. The seargs_spec_t, the
+// default values, the bitsets of required args and string defaults, the name
+// index, the index of environment variables and the list of bound args share
+// one block, laid out in that order.
+static size_t spec_bytes_(size_t num_args) {
+  return sizeof(seargs_spec_t) + num_args * sizeof(arg_val_t) +
+         2 * SEARGS_BITSET_WORDS(num_args) * sizeof(uint64_t) +
+         2 * name_index_cap_(num_args) * sizeof(int) + num_args * sizeof(int);
+}
+
+// Validates the defs while compiling them into a zeroed spec block of
+// spec_bytes_(num_args) bytes. Every check is a single pass over the defs.
+static bool compile_spec_(seargs_spec_t *spec, const arg_def_t *defs,
+                          int num_args) {
+  // no defs at all is only allowed for subcommands without options
+  if ((!defs && num_args > 0) || num_args < 0)
+    return false;
+
+  spec->defs = defs;
+  spec->num_args = num_args;
+  spec->defaults = (arg_val_t *)(spec + 1);
+  spec->required = (uint64_t *)(spec->defaults + num_args);
+  spec->string_defaults = spec->required + SEARGS_BITSET_WORDS(num_args);
+  spec->name_index =
+      (int *)(spec->string_defaults + SEARGS_BITSET_WORDS(num_args));
+  spec->index_cap = name_index_cap_(num_args);
+  spec->env_index = spec->name_index + spec->index_cap;
+  spec->bound = spec->env_index + spec->index_cap;
+
+  for (int i = 0; i < num_args; i++) {
+    if (!defs[i].name) {
+      fprintf(stderr, "Argument name cannot be null\n");
+      return false;
+    }
+    if (contains_format_specifier(defs[i].name) ||
+        contains_format_specifier(defs[i].desc)) {
+      fprintf(
+          stderr,
+          "Argument name/description contains invalid format specifier: %s\n",
+          defs[i].name);
+      return false;
+    }
+    if (defs[i].required) {
+      set_bit_(spec->required, i);
+      spec->num_required++;
+    } else {
+      spec->defaults[i] = defs[i].default_val;
+      if (defs[i].type == ARG_STRING && defs[i].default_val.string_val) {
+        set_bit_(spec->string_defaults, i);
+      }
+    }
+    spec->num_env += defs[i].env != NULL;
+    if (defs[i].bind) {
+      if (is_list_type_(defs[i].type)) {
+        fprintf(stderr, "List arguments cannot be bound: %s\n", defs[i].name);
+        return false;
+      }
+      spec->bound[spec->num_bound++] = i;
+    }
+  }
+  int dup = build_name_index_(defs, num_args, spec->name_index,
+                              spec->index_cap, false);
+  if (dup >= 0) {
+    fprintf(stderr, "Duplicate argument name: %s\n", defs[dup].name);
+    return false;
+  }
+  dup = build_name_index_(defs, num_args, spec->env_index, spec->index_cap,
+                          true);
+  if (dup >= 0) {
+    fprintf(stderr, "Duplicate environment variable: %s\n", defs[dup].env);
+    return false;
+  }
+  dup = build_short_index_(defs, num_args, spec->short_index);
+  if (dup >= 0) {
+    fprintf(stderr, "Duplicate short name: %c\n", defs[dup].short_name);
+    return false;
+  }
+  return true;
+}
+
+seargs_spec_t *seargs_compile(const arg_def_t *defs, size_t num_args) {
+  if (!defs || num_args <= 0)
+    return NULL;
+  seargs_spec_t *spec = calloc(1, spec_bytes_(num_args));
+  if (!spec) {
+    fprintf(stderr, "Failed to allocate memory\n");
+    return NULL;
+  }
+  if (!compile_spec_(spec, defs, num_args)) {
+    free(spec);
+    return NULL;
+  }
+  return spec;
+}
+
+void seargs_free_spec(seargs_spec_t **p_spec) {
+  if (!p_spec || !*p_spec)
+    return;
+  free(*p_spec);
+  *p_spec = NULL;
+}
+
+bool validate_arg_defs(const arg_def_t *defs, int num_args) {
+  if (!defs || num_args <= 0)
+    return false;
+  seargs_spec_t *spec = seargs_compile(defs, num_args);
+  bool valid = spec != NULL;
+  seargs_free_spec(&spec);
+  return valid;
+}
+
+void print_help(const arg_def_t *defs, int num_args) {
+  if (!defs || num_args <= 0)
+    return;
+  int max_name_len = 0;
+  for (int i = 0; i < num_args; i++) {
+    int current_len = strlen(defs[i].name);
+    if (current_len > max_name_len) {
+      max_name_len = current_len;
+    }
+  }
+  int total_pad_width = max_name_len + 5;
+  printf("Usage:\n");
+  for (int i = 0; i < num_args; i++) {
+    char short_name_part[6];
+    if (defs[i].short_name) {
+      snprintf(short_name_part, sizeof(short_name_part), "(-%c)",
+               defs[i].short_name);
+    } else {
+      snprintf(short_name_part, sizeof(short_name_part), "    ");
+    }
+    printf("  --%s %-*s  %s", defs[i].name,
+           (int)(total_pad_width - strlen(defs[i].name)), short_name_part,
+           defs[i].desc);
+    if (defs[i].env) {
+      printf(" [env: %s]", defs[i].env);
+    }
+    printf("\n");
+  }
+}
+
+/* ----------------- */
+/* Shell completion. */
+/* ----------------- */
+
+static bool completes_files_(arg_type_t type) {
+  return type == ARG_STRING || type == ARG_STRING_LIST;
+}
+
+// Prints name with every char that is not valid in a shell function name
+// replaced by _
+static void print_ident_(const char *name) {
+  for (const char *c = name; *c; c++) {
+    bool ok = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') ||
+              (*c >= '0' && *c <= '9') || *c == '_';
+    putchar(ok ? *c : '_');
+  }
+}
+
+// Prints str for use inside a single quoted string of the shell. For zsh the
+// chars _arguments gives a meaning to inside a description are escaped too.
+static void print_quoted_(const char *str, seargs_shell_t shell) {
+  for (const char *c = str ? str : ""; *c; c++) {
+    if (*c == '\'') {
+      fputs(shell == SEARGS_SHELL_FISH ? "\\'" : "'\\''", stdout);
+      continue;
+    }
+    if ((shell == SEARGS_SHELL_FISH && *c == '\\') ||
+        (shell == SEARGS_SHELL_ZSH &&
+         (*c == '[' || *c == ']' || *c == ':' || *c == '\\'))) {
+      putchar('\\');
+    }
+    putchar(*c);
+  }
+}
+
+static void print_bash_completion_(const char *prog, const arg_def_t *defs,
+                                   int num_args) {
+  printf("_");
+  print_ident_(prog);
+  printf("() {\n"
+         "  local cur=\"${COMP_WORDS[COMP_CWORD]}\"\n"
+         "  local prev=\"${COMP_WORDS[COMP_CWORD-1]}\"\n"
+         "  case \"$prev\" in\n");
+  // options taking a value complete that value instead of another option
+  for (int files = 1; files >= 0; files--) {
+    bool any = false;
+    for (int i = 0; i < num_args; i++) {
+      if (defs[i].type == ARG_FLAG || completes_files_(defs[i].type) != files) {
+        continue;
+      }
+      printf(any ? "|" : "  ");
+      printf("--%s", defs[i].name);
+      if (defs[i].short_name) {
+        printf("|-%c", defs[i].short_name);
+      }
+      any = true;
+    }
+    if (any) {
+      printf(files ? ")\n    COMPREPLY=($(compgen -f -- \"$cur\"))\n"
+                   : ")\n    COMPREPLY=()\n");
+      printf("    return\n    ;;\n");
+    }
+  }
+  printf("  esac\n"
+         "  if [[ \"$cur\" == -* ]]; then\n"
+         "    COMPREPLY=($(compgen -W '");
+  for (int i = 0; i < num_args; i++) {
+    printf("%s--%s", i ? " " : "", defs[i].name);
+    if (defs[i].short_name) {
+      printf(" -%c", defs[i].short_name);
+    }
+  }
+  printf("' -- \"$cur\"))\n"
+         "  else\n"
+         "    COMPREPLY=($(compgen -f -- \"$cur\"))\n"
+         "  fi\n"
+         "}\n"
+         "complete -o filenames -F _");
+  print_ident_(prog);
+  printf(" %s\n", prog);
+}
+
+static void print_zsh_completion_(const char *prog, const arg_def_t *defs,
+                                  int num_args) {
+  printf("#compdef %s\n\n_arguments -s -S", prog);
+  for (int i = 0; i < num_args; i++) {
+    const arg_def_t *def = &defs[i];
+    printf(" \\\n  ");
+    // lists may repeat, everything else excludes its other spelling
+    const char *repeat = is_list_type_(def->type) ? "*" : "";
+    if (!def->short_name) {
+      printf("'%s--%s[", repeat, def->name);
+    } else if (*repeat) {
+      printf("'*'{-%c,--%s}'[", def->short_name, def->name);
+    } else {
+      printf("'(-%c --%s)'{-%c,--%s}'[", def->short_name, def->name,
+             def->short_name, def->name);
+    }
+    print_quoted_(def->desc, SEARGS_SHELL_ZSH);
+    printf("]");
+    if (def->type != ARG_FLAG) {
+      printf(":");
+      print_quoted_(def->name, SEARGS_SHELL_ZSH);
+      printf(":%s", completes_files_(def->type) ? "_files" : " ");
+    }
+    printf("'");
+  }
+  printf(" \\\n  '*:file:_files'\n");
+}
+
+static void print_fish_completion_(const char *prog, const arg_def_t *defs,
+                                   int num_args) {
+  for (int i = 0; i < num_args; i++) {
+    const arg_def_t *def = &defs[i];
+    printf("complete -c %s", prog);
+    if (def->short_name) {
+      printf(" -s %c", def->short_name);
+    }
+    printf(" -l %s -d '", def->name);
+    print_quoted_(def->desc, SEARGS_SHELL_FISH);
+    printf("'");
+    if (def->type != ARG_FLAG) {
+      printf(completes_files_(def->type) ? " -r -F" : " -x");
+    }
+    printf("\n");
+  }
+}
+
+bool print_completion(const char *prog, const arg_def_t *defs, int num_args,
+                      seargs_shell_t shell) {
+  if (!prog || !defs || num_args < 0) {
+    return false;
+  }
+  switch (shell) {
+  case SEARGS_SHELL_BASH:
+    print_bash_completion_(prog, defs, num_args);
+    return true;
+  case SEARGS_SHELL_ZSH:
+    print_zsh_completion_(prog, defs, num_args);
+    return true;
+  case SEARGS_SHELL_FISH:
+    print_fish_completion_(prog, defs, num_args);
+    return true;
+  }
+  return false;
+}
+
+// Looks up the def named by the first len chars of name, which need not be
+// terminated there (--name=value)
+const arg_def_t *get_matching_arg_def_(parser_t *parser, const char *name,
+                                       size_t len, bool is_short_name) {
+  if (!parser || !name) {
+    return NULL;
+  }
+  if (!is_short_name) {
+    STAT_ADD_(parser, lookups, 1);
+    int i = find_long_index_(parser->spec, name, len,
+                             STAT_PTR_(parser, compares));
+    return i >= 0 ? &parser->defs[i] : NULL;
+  }
+  if (len != 1) {
+    return NULL;
+  }
+  STAT_ADD_(parser, lookups, 1);
+  int entry = parser->spec->short_index[(unsigned char)name[0]];
+  return entry ? &parser->defs[entry - 1] : NULL;
+}
+
+// Helper for a failed arena_alloc_(), running out of the callers buffer is a
+// regular error while running out of heap is fatal. def may be NULL.
+static parser_t *alloc_failure(parser_t *parser, const arg_def_t *def) {
+  if (parser->external) {
+    return failure(parser, "Buffer too small for value",
+                   def ? def->name : NULL, BUFFER_TOO_SMALL_ERR);
+  }
+  return fatal_failure(parser, "Failed to allocate memory");
+}
+
+// Upper bound of the number of comma separated items in the len bytes of
+// text. Commas are counted eight bytes at a time, swar_eq_() may also flag a
+// '-' right after one which only makes the bound a little loose.
+static size_t array_items_(const char *text, size_t len) {
+  size_t items = 1;
+  size_t i = 0;
+  for (; i + 8 <= len; i += 8) {
+    uint64_t x;
+    memcpy(&x, text + i, sizeof(x));
+    // one bit per flagged byte, summed up in the top byte
+    items += (((swar_eq_(x, ',') >> 7) * SWAR_ONES_) >> 56);
+  }
+  for (; i < len; i++) {
+    items += text[i] == ',';
+  }
+  return items;
+}
+
+// Appends the comma separated numbers in text to the list value of an array
+// arg. The list is sized once for all of them and the numbers are converted
+// straight into it. Returns 0 on success, -1 when out of memory and otherwise
+// the element (starting at 1) that is not a valid number.
+static int set_array_(parser_t *parser, const arg_def_t *def, int i,
+                      const char *text) {
+  size_t len = strlen(text);
+  const char *end = text + len;
+  size_t item_size = list_item_size_(def->type);
+  arg_list_t *list =
+      list_reserve_(parser, i, array_items_(text, len), item_size);
+  if (!list) {
+    return -1;
+  }
+  int *ints = (int *)(list + 1);
+  double *doubles = (double *)(list + 1);
+  const char *s = text;
+  for (int element = 1;; element++) {
+    if (def->type == ARG_INT_ARRAY) {
+      int64_t value;
+      if (!parse_i64_(&s, end, &value) || value < INT_MIN || value > INT_MAX) {
+        return element;
+      }
+      ints[list->count++] = (int)value;
+    } else if (!parse_double_(&s, end, &doubles[list->count++])) {
+      return element;
+    }
+    if (*s == '\0') {
+      return 0;
+    }
+    if (*s++ != ',') {
+      return element;
+    }
+  }
+}
+
+// Converts text into the value of the non flag arg i, appending it for list
+// types.
+// Strings are borrowed from text unless SEARGS_COPY_STRINGS is set. arg names
+// the source of the text in errors. Returns the parser or NULL on failure.
+static parser_t *set_value_(parser_t *parser, const arg_def_t *def, int i,
+                            const char *text, const char *arg) {
+  bool copy = parser->flags & SEARGS_COPY_STRINGS;
+  switch (def->type) {
+  case ARG_INT_LIST:
+  case ARG_DOUBLE_LIST:
+  case ARG_STRING_LIST: {
+    arg_val_t item;
+    const char *error = convert_value_(def->type, text, &item);
+    if (error) {
+      return failure(parser, error, arg, INVALID_VALUE_ERR);
+    }
+    if (def->type == ARG_STRING_LIST && copy) {
+      item.string_val = copy_string_(parser, item.string_val);
+      if (!item.string_val) {
+        return alloc_failure(parser, def);
+      }
+    }
+    if (!list_push_(parser, i, &item, list_item_size_(def->type))) {
+      return alloc_failure(parser, def);
+    }
+    return parser;
+  }
+  case ARG_INT_ARRAY:
+  case ARG_DOUBLE_ARRAY: {
+    int element = set_array_(parser, def, i, text);
+    if (element < 0) {
+      return alloc_failure(parser, def);
+    }
+    if (element > 0) {
+      return failure_at_(parser,
+                         def->type == ARG_INT_ARRAY
+                             ? "Invalid value for (expected integers)"
+                             : "Invalid value for (expected floats or doubles)",
+                         arg, INVALID_VALUE_ERR, element);
+    }
+    return parser;
+  }
+  default: {
+    // lazy values keep the text until the first read, which only works while
+    // the text is borrowed and not for bound args stored right after parsing
+    bool lazy = (parser->flags & SEARGS_LAZY) && !copy && !def->bind &&
+                def->type != ARG_STRING;
+    put_bit_(parser->lazy, i, lazy);
+    arg_val_t *value = &parser->values[i];
+    if (lazy) {
+      value->string_val = (char *)text;
+      return parser;
+    }
+    const char *error = convert_value_(def->type, text, value);
+    if (error) {
+      return failure(parser, error, arg, INVALID_VALUE_ERR);
+    }
+    if (def->type != ARG_STRING) {
+      return parser;
+    }
+    // argv outlives the parser so strings are borrowed unless asked to copy
+    put_bit_(parser->allocated, i, copy);
+    if (copy) {
+      value->string_val = copy_string_(parser, value->string_val);
+      if (!value->string_val) {
+        return alloc_failure(parser, def);
+      }
+    }
+    return parser;
+  }
+  }
+}
+
+// Value of a flag given as text (environment or config file), everything but
+// empty, 0, false, no and off sets it
+static bool flag_text_(const char *text) {
+  return *text && strcmp(text, "0") != 0 && strcmp(text, "false") != 0 &&
+         strcmp(text, "no") != 0 && strcmp(text, "off") != 0;
+}
+
+// Applies the environment variables bound to args (arg_def_t.env) that were
+// not given in argv, in a single pass over environ. Values are borrowed from
+// the environment like argv.
+static parser_t *apply_env_(parser_t *parser) {
+  const seargs_spec_t *spec = parser->spec;
+  int remaining = spec->num_env;
+  for (char **env = environ; env && *env && remaining > 0; env++) {
+    const char *entry = *env;
+    const char *eq = strchr(entry, '=');
+    if (!eq) {
+      continue;
+    }
+    STAT_ADD_(parser, lookups, 1);
+    int i = find_in_index_(spec->defs, spec->env_index, spec->index_cap, true,
+                           entry, eq - entry, STAT_PTR_(parser, compares));
+    if (i < 0) {
+      continue;
+    }
+    remaining--;
+    const arg_def_t *def = &spec->defs[i];
+    if (seargs_bit_(parser->found, i)) {
+      continue; // argv wins
+    }
+    const char *value = eq + 1;
+    set_bit_(parser->found, i);
+    if (def->type == ARG_FLAG) {
+      parser->values[i].flag_val = flag_text_(value);
+    } else if (!set_value_(parser, def, i, value, def->env)) {
+      return NULL;
+    }
+  }
+  return parser;
+}
+
+// Assigns a value given inside the option token itself (--name=value or
+// -nvalue), borrowed from the token like any other value. Flags take the
+// same values as in the environment.
+static parser_t *assign_inline_value_(parser_t *parser, const arg_def_t *def,
+                                      int index, const char *value,
+                                      const char *arg) {
+  set_bit_(parser->found, index);
+  if (def->type == ARG_FLAG) {
+    parser->values[index].flag_val = flag_text_(value);
+    return parser;
+  }
+  return set_value_(parser, def, index, value, arg);
+}
+
+// (parser_t *) but only ever returns the parser you passed in or null for
+// error. that is return truthy value on success otherwise a falsy value.
+parser_t *assign_value(const arg_def_t *def, const char *argv[], int *i,
+                       int argc, parser_t *parser, int index) {
+  if (index < 0 || !def) {
+    return NULL;
+  }
+  if (*i >= argc) {
+    return failure(parser, "Missing value for", def->name, MISSING_VALUE_ERR);
+  }
+  const char *arg = argv[*i];
+  set_bit_(parser->found, index);
+  if (def->type == ARG_FLAG) {
+    parser->values[index].flag_val = true;
+    return parser;
+  }
+  if (*i + 1 >= argc) {
+    return failure(parser, "Missing value for", arg, MISSING_VALUE_ERR);
+  }
+  STAT_ADD_(parser, tokens, 1);
+  return set_value_(parser, def, index, argv[++*i], arg);
+}
+
+// Bytes needed for a parser of num_args defs. The parser_t, the values and
+// the four bitsets of its state share one block, laid out in that order.
+static size_t parser_bytes_(size_t num_args) {
+  return sizeof(parser_t) + num_args * sizeof(arg_val_t) +
+         4 * SEARGS_BITSET_WORDS(num_args) * sizeof(uint64_t);
+}
+
+// Sets the values to the specs defaults and clears every state bit. Not timed,
+// the defaults phase is reported once per parse after argv is done.
+static void reset_states_(parser_t *parser) {
+  memcpy(parser->values, parser->spec->defaults,
+         parser->num_args * sizeof(arg_val_t));
+  // the bitsets are contiguous, starting with found
+  memset(parser->found, 0,
+         4 * SEARGS_BITSET_WORDS(parser->num_args) * sizeof(uint64_t));
+}
+
+// Points the state of a parser block at the memory right after the parser_t
+// and resets the parser to the specs default values
+static void init_parser_(parser_t *parser, const seargs_spec_t *spec,
+                         unsigned flags) {
+  parser->spec = spec;
+  parser->defs = spec->defs;
+  parser->num_args = spec->num_args;
+  parser->flags = flags;
+  size_t words = SEARGS_BITSET_WORDS(spec->num_args);
+  parser->values = (arg_val_t *)(parser + 1);
+  parser->found = (uint64_t *)(parser->values + spec->num_args);
+  parser->allocated = parser->found + words;
+  parser->from_config = parser->allocated + words;
+  parser->lazy = parser->from_config + words;
+  reset_states_(parser);
+}
+
+// Loads path into the parsers files, where it stays until the parser is reset
+// or freed. Fails with msg, arg and err_code if the file cannot be read.
+static seargs_file_t *add_file_(parser_t *parser, const char *path,
+                                const char *msg, const char *arg,
+                                seargs_err_codes err_code) {
+  if (parser->num_files == parser->files_cap) {
+    int cap = parser->files_cap ? parser->files_cap * 2 : 4;
+    seargs_file_t *files = realloc(parser->files, cap * sizeof(*files));
+    if (!files) {
+      fatal_failure(parser, "Failed to allocate memory");
+      return NULL;
+    }
+    STAT_ADD_(parser, allocations, 1);
+    parser->files = files;
+    parser->files_cap = cap;
+  }
+  seargs_file_t *file = &parser->files[parser->num_files];
+  if (!load_file_(path, file)) {
+    failure(parser, msg, arg, err_code);
+    return NULL;
+  }
+  parser->num_files++;
+  return file;
+}
+
+// Appends a token to the parsers token vector, growing it geometrically
+static bool push_token_(parser_t *parser, const char *token) {
+  if (parser->num_tokens == parser->tokens_cap) {
+    int cap = parser->tokens_cap ? parser->tokens_cap * 2 : 64;
+    const char **tokens = realloc(parser->tokens, cap * sizeof(*tokens));
+    if (!tokens) {
+      return false;
+    }
+    STAT_ADD_(parser, allocations, 1);
+    parser->tokens = tokens;
+    parser->tokens_cap = cap;
+  }
+  parser->tokens[parser->num_tokens++] = token;
+  return true;
+}
+
+// Identity of a response file that is being expanded, for cycle detection
+typedef struct {
+  unsigned long long dev;
+  unsigned long long ino;
+} file_id_t;
+
+// Expands a single token into the token vector, recursing into @file tokens.
+// chain holds the files currently being expanded, depth of them.
+static bool expand_token_(parser_t *parser, const char *token,
+                          file_id_t *chain, int depth, bool *literal);
+
+// Loads a response file and expands each of its tokens in order
+static bool expand_response_file_(parser_t *parser, const char *arg,
+                                  file_id_t *chain, int depth,
+                                  bool *literal) {
+  const char *path = arg + 1;
+  if (depth >= SEARGS_MAX_RESPONSE_DEPTH) {
+    failure(parser, "Response files nested too deeply", arg,
+            RESPONSE_FILE_ERR);
+    return false;
+  }
+#if !defined(_WIN32)
+  struct stat st;
+  if (stat(path, &st) == 0) {
+    file_id_t id = {(unsigned long long)st.st_dev,
+                    (unsigned long long)st.st_ino};
+    for (int i = 0; i < depth; i++) {
+      if (chain[i].dev == id.dev && chain[i].ino == id.ino) {
+        failure(parser, "Response file includes itself", arg,
+                RESPONSE_FILE_ERR);
+        return false;
+      }
+    }
+    chain[depth] = id;
+  }
+#endif
+
+  seargs_file_t *file = add_file_(parser, path, "Cannot read response file",
+                                  arg, RESPONSE_FILE_ERR);
+  if (!file) {
+    return false;
+  }
+
+  char *cursor = file->data;
+  char *end = file->data + file->size;
+  bool unterminated = false;
+  char *token;
+  while ((token = next_token_(&cursor, end, &unterminated))) {
+    if (!expand_token_(parser, token, chain, depth + 1, literal)) {
+      return false;
+    }
+  }
+  if (unterminated) {
+    failure(parser, "Unterminated quote in response file", arg,
+            RESPONSE_FILE_ERR);
+    return false;
+  }
+  return true;
+}
+
+static bool expand_token_(parser_t *parser, const char *token,
+                          file_id_t *chain, int depth, bool *literal) {
+  if (!*literal && token[0] == '@' && token[1] != '\0') {
+    return expand_response_file_(parser, token, chain, depth, literal);
+  }
+  if (strcmp(token, "--") == 0) {
+    *literal = true; // no expansion past the terminator
+  }
+  if (!push_token_(parser, token)) {
+    fatal_failure(parser, "Failed to allocate memory");
+    return false;
+  }
+  return true;
+}
+
+// Replaces every @file in argv with the tokens of that file, the result is
+// in parser->tokens. Files are tokenized in place and stay loaded for as long
+// as the parser since the tokens (and borrowed string values) point into them.
+static parser_t *expand_response_files_(parser_t *parser, int argc,
+                                        const char *argv[]) {
+  if (parser->external) {
+    return failure(parser, "Response files need a heap allocated parser", NULL,
+                   RESPONSE_FILE_ERR);
+  }
+  file_id_t chain[SEARGS_MAX_RESPONSE_DEPTH];
+  bool literal = false;
+  // argv[0] is the program and never expanded
+  if (argc > 0 && !push_token_(parser, argv[0])) {
+    return fatal_failure(parser, "Failed to allocate memory");
+  }
+  for (int i = 1; i < argc; i++) {
+    if (!expand_token_(parser, argv[i], chain, 0, &literal)) {
+      return NULL;
+    }
+  }
+  return parser;
+}
+
+// Checks if argv has an @file before the -- terminator
+static bool has_response_file_(int argc, const char *argv[]) {
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--") == 0) {
+      return false;
+    }
+    if (argv[i][0] == '@' && argv[i][1] != '\0') {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Applies one `key = value` line of the config file in [line, eol). Keys and
+// values are cut out of the file in place, eol must be writable.
+static parser_t *apply_config_line_(parser_t *parser, char *line, char *eol) {
+  while (line < eol && is_space_(*line)) {
+    line++;
+  }
+  while (eol > line && is_space_(eol[-1])) {
+    eol--;
+  }
+  if (line == eol || *line == '#' || *line == ';') {
+    return parser; // blank or comment
+  }
+  char *eq = memchr(line, '=', eol - line);
+  char *key_end = eq ? eq : eol;
+  while (key_end > line && is_space_(key_end[-1])) {
+    key_end--;
+  }
+  char *value = NULL;
+  if (eq) {
+    value = eq + 1;
+    while (value < eol && is_space_(*value)) {
+      value++;
+    }
+    if (eol - value >= 2 && (*value == '"' || *value == '\'') &&
+        eol[-1] == *value) {
+      value++;
+      eol--;
+    }
+    *eol = '\0';
+  }
+  *key_end = '\0';
+  if (key_end == line) {
+    return failure(parser, "Missing key in config file", NULL,
+                   INVALID_ARG_ERR);
+  }
+
+  const seargs_spec_t *spec = parser->spec;
+  STAT_ADD_(parser, lookups, 1);
+  int i = find_long_index_(spec, line, key_end - line,
+                           STAT_PTR_(parser, compares));
+  if (i < 0) {
+    return failure(parser, "Unknown config key", line, UNKNOWN_ARG_ERR);
+  }
+  const arg_def_t *def = &spec->defs[i];
+  if (seargs_bit_(parser->found, i) && !seargs_bit_(parser->from_config, i)) {
+    return parser; // argv and env win
+  }
+  set_bit_(parser->found, i);
+  set_bit_(parser->from_config, i);
+  if (def->type == ARG_FLAG) {
+    parser->values[i].flag_val = !value || flag_text_(value); // bare key
+    return parser;
+  }
+  if (!value) {
+    return failure(parser, "Missing value for", line, MISSING_VALUE_ERR);
+  }
+  return set_value_(parser, def, i, value, line);
+}
+
+// Applies the config file set with seargs_set_config() to the args that argv
+// and the environment left unset. The file is loaded like a response file so
+// borrowed strings live as long as the parsers results.
+static parser_t *apply_config_(parser_t *parser) {
+  seargs_file_t *file = add_file_(parser, parser->config,
+                                  "Cannot read config file", parser->config,
+                                  CONFIG_FILE_ERR);
+  if (!file) {
+    if (parser->error.code == CONFIG_FILE_ERR) {
+      parser->error.file = parser->config; // line stays 0, the file is unread
+    }
+    return NULL;
+  }
+  char *cursor = file->data;
+  char *end = file->data + file->size;
+  parser_t *result = parser;
+  for (int line = 1; cursor < end && result; line++) {
+    char *eol = memchr(cursor, '\n', end - cursor);
+    if (!eol) {
+      eol = end;
+    }
+    char *next = eol < end ? eol + 1 : end;
+    parser->config_line = line;
+    result = apply_config_line_(parser, cursor, eol);
+    cursor = next;
+  }
+  parser->config_line = 0;
+  return result;
+}
+
+// Replaces the string defaults left in place by copies (SEARGS_COPY_STRINGS),
+// going over the args with one a word of the bitsets at a time
+static parser_t *copy_string_defaults_(parser_t *parser) {
+  const seargs_spec_t *spec = parser->spec;
+  for (int w = 0; w < SEARGS_BITSET_WORDS(parser->num_args); w++) {
+    uint64_t left = spec->string_defaults[w] & ~parser->found[w];
+    for (; left; left &= left - 1) {
+      int i = w * 64 + lowest_bit_(left);
+      const arg_def_t *def = &parser->defs[i];
+      parser->values[i].string_val =
+          copy_string_(parser, def->default_val.string_val);
+      if (!parser->values[i].string_val) {
+        return alloc_failure(parser, def);
+      }
+      set_bit_(parser->allocated, i);
+    }
+  }
+  return parser;
+}
+
+// Writes the final value of every bound arg (arg_def_t.bind) to its
+// destination, only done once the whole parse succeeded
+static void store_bindings_(parser_t *parser) {
+  const seargs_spec_t *spec = parser->spec;
+  for (int b = 0; b < spec->num_bound; b++) {
+    int i = spec->bound[b];
+    void *dest = parser->defs[i].bind;
+    const arg_val_t *value = &parser->values[i];
+    switch (parser->defs[i].type) {
+    case ARG_FLAG:
+      *(bool *)dest = value->flag_val;
+      break;
+    case ARG_INT:
+      *(int *)dest = value->int_val;
+      break;
+    case ARG_DOUBLE:
+      *(double *)dest = value->double_val;
+      break;
+    case ARG_STRING:
+      *(const char **)dest = value->string_val;
+      break;
+    case ARG_INT64:
+      *(int64_t *)dest = value->int64_val;
+      break;
+    case ARG_UINT64:
+      *(uint64_t *)dest = value->uint64_val;
+      break;
+    case ARG_SIZE:
+      *(size_t *)dest = (size_t)value->uint64_val;
+      break;
+    default:
+      break; // lists cannot be bound
+    }
+  }
+}
+
+// Whether every option of a short cluster is known, up to the first one that
+// takes a value and with it the rest of the cluster. False for an empty one.
+static bool cluster_known_(const parser_t *parser, const char *cluster) {
+  if (cluster[0] == '\0') {
+    return false;
+  }
+  for (int j = 0; cluster[j] != '\0'; j++) {
+    int entry = parser->spec->short_index[(unsigned char)cluster[j]];
+    if (!entry) {
+      return false;
+    }
+    if (parser->defs[entry - 1].type != ARG_FLAG) {
+      return true;
+    }
+  }
+  return true;
+}
+
+// Appends token to the passthrough array, which has room for all of argv
+static void pass_through_(parser_t *parser, const char *token) {
+  parser->passthrough[parser->num_passthrough++] = token;
+  parser->passthrough[parser->num_passthrough] = NULL;
+}
+
+// Runs the parse loop over argv and fills in the defaults of the args that
+// were not found. Returns NULL with parser->error set on failure.
+static parser_t *parse_tokens_(parser_t *parser, int argc,
+                               const char *argv[]) {
+  PHASE_BEGIN_(parse_start);
+  const arg_def_t *args_defs = parser->defs;
+  if ((parser->flags & SEARGS_RESPONSE_FILES) &&
+      has_response_file_(argc, argv)) {
+    if (!expand_response_files_(parser, argc, argv)) {
+      return NULL;
+    }
+    argc = parser->num_tokens;
+    argv = parser->tokens;
+  }
+  bool passthrough = parser->flags & SEARGS_PASSTHROUGH;
+  bool forwarding = false; // the last option was unknown and passed through
+  if (passthrough) {
+    // argv[0], each token at most once and the terminating NULL
+    parser->passthrough = arena_alloc_(
+        parser, (argc + 1) * sizeof(const char *), SEARGS_ARENA_ALIGN);
+    if (!parser->passthrough) {
+      return alloc_failure(parser, NULL);
+    }
+    parser->passthrough[0] = NULL;
+    parser->num_passthrough = 0;
+    if (argc > 0) {
+      pass_through_(parser, argv[0]);
+    }
+  }
+  // main parse loop
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    STAT_ADD_(parser, tokens, 1);
+    if (strcmp(arg, "--") == 0) {
+      for (i++; passthrough && i < argc; i++) {
+        pass_through_(parser, argv[i]);
+      }
+      break;
+    }
+    if (arg[0] != '-') {
+      if (forwarding) {
+        pass_through_(parser, arg); // a value of the unknown option
+        continue;
+      }
+      if (parser->flags & SEARGS_STOP_AT_POSITIONAL) {
+        parser->pos_args = &argv[i];
+        parser->num_pos_args = argc - i;
+        break;
+      }
+      continue;
+    }
+    forwarding = false;
+    if (arg[1] == '-') {
+      // --name=value is matched on the name part in place
+      const char *name = arg + 2;
+      size_t name_len = strcspn(name, "=");
+      const arg_def_t *def =
+          get_matching_arg_def_(parser, name, name_len, false);
+      if (!def && passthrough) {
+        pass_through_(parser, arg);
+        forwarding = true;
+        continue;
+      }
+      if (!def) {
+        return failure(parser, "Unknown argument", arg, UNKNOWN_ARG_ERR);
+      }
+      int def_index = def - args_defs;
+      if (name[name_len] == '=') {
+        if (!assign_inline_value_(parser, def, def_index, name + name_len + 1,
+                                  arg)) {
+          return NULL;
+        }
+      } else if (!assign_value(def, argv, &i, argc, parser, def_index)) {
+        return NULL;
+      };
+    } else {
+      const char *arg_cluster = arg + 1;
+      // a cluster with an unknown option goes through as a whole, none of
+      // its options are applied. So does a lone -
+      if (passthrough && !cluster_known_(parser, arg_cluster)) {
+        pass_through_(parser, arg);
+        forwarding = true;
+        continue;
+      }
+      if (arg_cluster[0] == '\0') {
+        return failure(parser, "Invalid short argument", arg, INVALID_ARG_ERR);
+      }
+      for (int j = 0; arg_cluster[j] != '\0'; j++) {
+        bool is_last = arg_cluster[j + 1] == '\0';
+        STAT_ADD_(parser, lookups, 1);
+        int entry = parser->spec->short_index[(unsigned char)arg_cluster[j]];
+        if (!entry) {
+          return failure(parser, "Unknown argument", arg, UNKNOWN_ARG_ERR);
+        }
+        const arg_def_t *def = &args_defs[entry - 1];
+        if (def->type != ARG_FLAG && !is_last) {
+          // -ovalue, the rest of the cluster is the value
+          if (!assign_inline_value_(parser, def, entry - 1, &arg_cluster[j + 1],
+                                    arg)) {
+            return NULL;
+          }
+          break;
+        }
+        if (!assign_value(def, argv, &i, argc, parser, entry - 1)) {
+          return NULL;
+        }
+        if (def->type != ARG_FLAG) {
+          break;
+        }
       }
     }
+    if (parser->flags & SEARGS_STOP_AT_POSITIONAL) {
+      continue; // pos_args only starts at the positional that stopped us
+    }
+    parser->pos_args = (i < argc) ? &argv[i] : NULL;
+    parser->num_pos_args = (i < argc) ? argc - i : 0;
+  }
+  const seargs_spec_t *spec = parser->spec;
+  if (spec->num_env > 0 && !apply_env_(parser)) {
+    return NULL;
+  }
+  if (parser->config && !apply_config_(parser)) {
+    return NULL;
+  }
+  // required args that were not found, a word of the bitsets at a time.
+  // Defaults are already in place.
+  for (int w = 0; spec->num_required && w < SEARGS_BITSET_WORDS(spec->num_args);
+       w++) {
+    uint64_t missing = spec->required[w] & ~parser->found[w];
+    if (missing) {
+      return failure(parser, "Missing required argument",
+                     args_defs[w * 64 + lowest_bit_(missing)].name,
+                     MISSING_ARG_ERR);
+    }
+  }
+  PHASE_END_(parser, SEARGS_PHASE_PARSE, parse_start);
+  PHASE_BEGIN_(defaults_start);
+  if ((parser->flags & SEARGS_COPY_STRINGS) &&
+      !copy_string_defaults_(parser)) {
+    return NULL;
+  }
+  store_bindings_(parser);
+  PHASE_END_(parser, SEARGS_PHASE_DEFAULTS, defaults_start);
+  return parser;
+}
+
+// parses the provided arguments, checking validity and returning a pointer
+// to the parsed args. returns NULL on failure
+parser_t *parse_args(int argc, const char *argv[], const arg_def_t *args_defs,
+                     size_t num_args) {
+  return parse_args_ex(argc, argv, args_defs, num_args, SEARGS_DEFAULT);
+}
+
+// Creates a parser owning a spec of defs compiled into the same block, right
+// after its states. Returns NULL if the defs are invalid.
+static parser_t *new_owning_parser_(const arg_def_t *args_defs,
+                                   size_t num_args, unsigned flags) {
+  size_t bytes = parser_bytes_(num_args);
+  parser_t *parser = calloc(1, bytes + spec_bytes_(num_args));
+  if (!parser) {
+    return fatal_failure(parser, "Failed to allocate memory");
+  }
+  STAT_ADD_(parser, allocations, 1);
+  seargs_spec_t *spec = (seargs_spec_t *)((char *)parser + bytes);
+  PHASE_BEGIN_(start);
+  if (!compile_spec_(spec, args_defs, num_args)) {
+    free(parser);
+    return NULL;
+  }
+  PHASE_END_(parser, SEARGS_PHASE_VALIDATE, start);
+  init_parser_(parser, spec, flags);
+  return parser;
+}
+
+parser_t *parse_args_ex(int argc, const char *argv[],
+                        const arg_def_t *args_defs, size_t num_args,
+                        unsigned flags) {
+  if (!args_defs || num_args <= 0) {
+    return NULL;
+  }
+  parser_t *parser = new_owning_parser_(args_defs, num_args, flags);
+  if (!parser) {
+    return NULL;
+  }
+
+  // without options there is nothing to parse, unless the environment or
+  // bound destinations still have to be filled in
+  if (argc <= 1 && !parser->spec->num_env && !parser->spec->num_bound) {
+    print_help(args_defs, num_args);
+    free(parser);
+    return NULL;
+  }
+
+  if (!parse_tokens_(parser, argc, argv)) {
+    _cleanup_parser(parser);
+    return NULL;
+  }
+  return parser;
+}
+
+parser_t *parse_commands(int argc, const char *argv[],
+                         const arg_def_t *args_defs, size_t num_args,
+                         const seargs_command_t *commands,
+                         size_t num_commands, unsigned flags) {
+  // no global options at all is fine, the subcommands may have them all
+  if ((!args_defs && num_args > 0) || !commands || num_commands <= 0) {
+    return NULL;
+  }
+  parser_t *parser = new_owning_parser_(args_defs, num_args,
+                                        flags | SEARGS_STOP_AT_POSITIONAL);
+  if (!parser) {
+    return NULL;
+  }
+  if (!parse_tokens_(parser, argc, argv)) {
+    _cleanup_parser(parser);
+    return NULL;
+  }
+  if (parser->num_pos_args == 0) {
+    return parser; // no subcommand given
+  }
+
+  // only the selected subcommand is ever compiled
+  const char *name = parser->pos_args[0];
+  for (size_t i = 0; i < num_commands && !parser->command; i++) {
+    if (strcmp(commands[i].name, name) == 0) {
+      parser->command = &commands[i];
+    }
+  }
+  if (!parser->command) {
+    failure(parser, "Unknown command", name, UNKNOWN_ARG_ERR);
+    _cleanup_parser(parser);
+    return NULL;
+  }
+  // response files were already expanded for the whole command line
+  parser->sub = new_owning_parser_(parser->command->defs,
+                                   parser->command->num_args,
+                                   flags & ~SEARGS_RESPONSE_FILES);
+  if (!parser->sub ||
+      !parse_tokens_(parser->sub, parser->num_pos_args, parser->pos_args)) {
+    _cleanup_parser(parser);
+    return NULL;
+  }
+  return parser;
+}
+
+void print_commands(const seargs_command_t *commands, int num_commands) {
+  if (!commands || num_commands <= 0)
+    return;
+  int max_name_len = 0;
+  for (int i = 0; i < num_commands; i++) {
+    int current_len = strlen(commands[i].name);
+    if (current_len > max_name_len) {
+      max_name_len = current_len;
+    }
+  }
+  printf("Commands:\n");
+  for (int i = 0; i < num_commands; i++) {
+    printf("  %-*s  %s\n", max_name_len, commands[i].name,
+           commands[i].desc ? commands[i].desc : "");
+  }
+}
+
+parser_t *seargs_new_parser(const seargs_spec_t *spec, unsigned flags) {
+  if (!spec) {
+    return NULL;
+  }
+  parser_t *parser = calloc(1, parser_bytes_(spec->num_args));
+  if (!parser) {
+    return fatal_failure(parser, "Failed to allocate memory");
+  }
+  STAT_ADD_(parser, allocations, 1);
+  init_parser_(parser, spec, flags);
+  return parser;
+}
+
+parser_t *seargs_parse(const seargs_spec_t *spec, int argc, const char *argv[],
+                       unsigned flags) {
+  parser_t *parser = seargs_new_parser(spec, flags);
+  if (!parser) {
+    return NULL;
+  }
+  if (!parse_tokens_(parser, argc, argv)) {
+    _cleanup_parser(parser);
+    return NULL;
+  }
+  return parser;
+}
+
+size_t seargs_required_bytes(size_t num_args) {
+  return parser_bytes_(num_args) + spec_bytes_(num_args) + SEARGS_BUF_ALIGN -
+         1;
+}
+
+size_t seargs_required_bytes_for(int argc, const char *argv[],
+                                 const arg_def_t *args_defs, size_t num_args,
+                                 unsigned flags) {
+  if (!args_defs || num_args <= 0) {
+    return 0;
+  }
+  // a trial parse on the heap, arena_wanted adds up every request with its
+  // worst case padding so it bounds what one contiguous buffer needs
+  parser_t *parser = new_owning_parser_(args_defs, num_args, flags);
+  if (!parser) {
+    return 0;
+  }
+  parse_tokens_(parser, argc, argv);
+  size_t bytes = parser->error.code == OUT_OF_MEMORY_ERR
+                     ? 0
+                     : seargs_required_bytes(num_args) + parser->arena_wanted;
+  _cleanup_parser(parser);
+  return bytes;
+}
+
+seargs_err_codes parse_args_into(void *buf, size_t buf_size, int argc,
+                                 const char *argv[],
+                                 const arg_def_t *args_defs, size_t num_args,
+                                 unsigned flags, parser_t **out_parser) {
+  if (!out_parser) {
+    return INVALID_ARG_ERR;
+  }
+  *out_parser = NULL;
+  if (!args_defs || num_args <= 0) {
+    return INVALID_DEF_ERR;
+  }
+  if (!buf || buf_size < seargs_required_bytes(num_args)) {
+    return BUFFER_TOO_SMALL_ERR;
+  }
+
+  size_t pad = (SEARGS_BUF_ALIGN - (uintptr_t)buf % SEARGS_BUF_ALIGN) %
+               SEARGS_BUF_ALIGN;
+  size_t bytes = parser_bytes_(num_args) + spec_bytes_(num_args);
+  parser_t *parser = (parser_t *)((char *)buf + pad);
+  memset(parser, 0, bytes);
+  seargs_spec_t *spec =
+      (seargs_spec_t *)((char *)parser + parser_bytes_(num_args));
+  PHASE_BEGIN_(start);
+  if (!compile_spec_(spec, args_defs, num_args)) {
+    return INVALID_DEF_ERR;
+  }
+  PHASE_END_(parser, SEARGS_PHASE_VALIDATE, start);
+  init_parser_(parser, spec, flags);
+  // whatever is left of the buffer holds the string copies
+  parser->external = true;
+  parser->arena = (char *)parser + bytes;
+  parser->arena_size = buf_size - pad - bytes;
+
+  *out_parser = parser;
+  parse_tokens_(parser, argc, argv);
+  return parser->error.code;
+}
+
+void seargs_reset(parser_t *parser) {
+  if (!parser) {
+    return;
+  }
+  release_response_files_(parser);
+  _cleanup_parser(parser->sub);
+  parser->sub = NULL;
+  parser->command = NULL;
+  // merge the chunks the last parse needed into one that fits all of it
+  if (parser->chunks && parser->chunks->next) {
+    size_t wanted = parser->arena_wanted;
+    free_chunks_(parser);
+    parser->arena = NULL;
+    parser->arena_size = 0;
+    parser->arena_used = 0;
+    arena_alloc_(parser, wanted, 1);
+  }
+  parser->arena_used = 0;
+  parser->arena_wanted = 0;
+#if defined(SEARGS_STATS)
+  parser->stats = (seargs_stats_t){0};
+#endif
+  reset_states_(parser);
+  parser->error =
+      (seargs_error_t){.code = SEARGS_OK, .msg = NULL, .arg_name = NULL};
+  parser->pos_args = NULL;
+  parser->num_pos_args = 0;
+  parser->passthrough = NULL;
+  parser->num_passthrough = 0;
+}
+
+seargs_err_codes seargs_parse_line(parser_t *parser, char *line) {
+  if (!parser || !line) {
+    return INVALID_ARG_ERR;
+  }
+  seargs_reset(parser);
+  if (parser->external) {
+    failure(parser, "Command lines need a heap allocated parser", NULL,
+            INVALID_ARG_ERR);
+    return parser->error.code;
+  }
+  char *cursor = line;
+  char *end = line + strlen(line);
+  bool unterminated = false;
+  char *token;
+  while ((token = next_token_(&cursor, end, &unterminated))) {
+    if (!push_token_(parser, token)) {
+      fatal_failure(parser, "Failed to allocate memory");
+      return parser->error.code;
+    }
+  }
+  if (unterminated) {
+    failure(parser, "Unterminated quote", NULL, INVALID_ARG_ERR);
+    return parser->error.code;
+  }
+  // the tokens are already the whole command, @file would expand into them
+  unsigned flags = parser->flags;
+  parser->flags &= ~SEARGS_RESPONSE_FILES;
+  parse_tokens_(parser, parser->num_tokens, parser->tokens);
+  parser->flags = flags;
+  return parser->error.code;
+}
+
+seargs_err_codes seargs_parse_lines(parser_t *parser, const char *path,
+                                    seargs_line_fn fn, void *ctx) {
+  if (!parser || !path || !fn) {
+    return INVALID_ARG_ERR;
+  }
+  seargs_file_t file;
+  if (!load_file_(path, &file)) {
+    return FILE_READ_ERR;
+  }
+  seargs_err_codes result = SEARGS_OK;
+  char *cursor = file.data;
+  char *end = file.data + file.size;
+  for (int line = 1; cursor < end; line++) {
+    char *eol = memchr(cursor, '\n', end - cursor);
+    if (!eol) {
+      eol = end;
+    }
+    *eol = '\0';
+    char *text = cursor;
+    cursor = eol < end ? eol + 1 : end;
+    while (is_space_(*text)) {
+      text++;
+    }
+    if (*text == '\0' || *text == '#') {
+      continue; // blank or comment
+    }
+    seargs_parse_line(parser, text);
+    if (parser->error.code != SEARGS_OK) {
+      parser->error.file = path;
+      parser->error.line = line;
+    }
+    if (!fn(ctx, parser, line)) {
+      result = parser->error.code;
+      break;
+    }
+  }
+  // values borrowed from the file are gone after this
+  seargs_reset(parser);
+  unload_file_(&file);
+  return result;
+}
+
+const seargs_stats_t *seargs_stats(const parser_t *parser) {
+#if defined(SEARGS_STATS)
+  return parser ? &parser->stats : NULL;
+#else
+  (void)parser;
+  return NULL;
+#endif
+}
+
+bool seargs_set_phase_hook(parser_t *parser, seargs_phase_hook_t hook,
+                           void *ctx) {
+#if defined(SEARGS_STATS)
+  if (!parser) {
+    return false;
+  }
+  parser->phase_hook = hook;
+  parser->phase_hook_ctx = ctx;
+  return true;
+#else
+  (void)parser;
+  (void)hook;
+  (void)ctx;
+  return false;
+#endif
+}
+
+void seargs_set_config(parser_t *parser, const char *path) {
+  if (parser) {
+    parser->config = path;
+  }
+}
+
+seargs_err_codes seargs_reparse(parser_t *parser, int argc,
+                                const char *argv[]) {
+  if (!parser) {
+    return INVALID_ARG_ERR;
+  }
+  seargs_reset(parser);
+  parse_tokens_(parser, argc, argv);
+  return parser->error.code;
+}
+
+// Free all arguments after use.
+
+void free_parser(parser_t **p_parser) {
+  if (!p_parser || !*p_parser)
+    return;
+  _cleanup_parser(*p_parser);
+  *p_parser = NULL;
+}
+
+int get_arg_index_(const parser_t *parser, const char *name) {
+  if (!parser || !name) {
+    return -1;
+  }
+  // not counted, the const getters must not write to the parser
+  return find_long_index_(parser->spec, name, strlen(name), NULL);
+}
+
+int seargs_lookup_(parser_t *parser, const char *name) {
+  if (!parser || !name) {
+    return -1;
+  }
+  STAT_ADD_(parser, lookups, 1);
+  return find_long_index_(parser->spec, name, strlen(name),
+                          STAT_PTR_(parser, compares));
+}
+
+seargs_handle_t seargs_resolve(parser_t *parser, const char *name,
+                               arg_type_t type) {
+  seargs_handle_t handle = {.index = -1, .type = type};
+  if (!parser) {
+    return handle;
+  }
+  int i = seargs_lookup_(parser, name);
+  if (i < 0) {
+    parser->error = (seargs_error_t){
+        .code = UNKNOWN_ARG_ERR, .msg = "Unknown argument", .arg_name = name};
+    return handle;
+  }
+  if (parser->defs[i].type != type) {
+    parser->error = (seargs_error_t){.code = TYPE_MISMATCH_ERR,
+                                     .msg = "Argument type mismatch",
+                                     .arg_name = parser->defs[i].name};
+    return handle;
+  }
+  if (!seargs_convert_(parser, i)) {
+    return handle; // handles are read directly so lazy values convert here
+  }
+  handle.index = i;
+  return handle;
+}
+
+bool seargs_convert_(parser_t *parser, int index) {
+  if (!seargs_bit_(parser->lazy, index)) {
+    return true;
+  }
+  const arg_def_t *def = &parser->defs[index];
+  arg_val_t value;
+  const char *error =
+      convert_value_(def->type, parser->values[index].string_val, &value);
+  if (error) {
+    failure(parser, error, def->name, INVALID_VALUE_ERR);
+    return false;
+  }
+  parser->values[index] = value;
+  put_bit_(parser->lazy, index, false);
+  return true;
+}
+
+void *get_arg_val(parser_t *parser, const char *name) {
+  int i = seargs_lookup_(parser, name);
+  if (i < 0 || !seargs_convert_(parser, i)) {
+    return NULL; // not found or invalid
+  }
+  arg_val_t *value = &parser->values[i];
+  switch (parser->defs[i].type) {
+  case ARG_FLAG:
+    return &value->flag_val;
+  case ARG_INT:
+    return &value->int_val;
+  case ARG_DOUBLE:
+    return &value->double_val;
+  case ARG_STRING:
+    return &value->string_val;
+  case ARG_INT64:
+    return &value->int64_val;
+  case ARG_UINT64:
+  case ARG_SIZE:
+    return &value->uint64_val;
+  case ARG_INT_LIST:
+  case ARG_DOUBLE_LIST:
+  case ARG_STRING_LIST:
+  case ARG_INT_ARRAY:
+  case ARG_DOUBLE_ARRAY:
+    return &value->list_val;
+  }
+  return NULL;
+}
+
+seargs_err_codes seargs_get(const parser_t *parser, const char *name,
+                            arg_type_t type, arg_val_t *out) {
+  if (!parser || !name || !out) {
+    return INVALID_ARG_ERR;
+  }
+  int i = get_arg_index_(parser, name);
+  if (i < 0) {
+    return UNKNOWN_ARG_ERR;
+  }
+  if (parser->defs[i].type != type) {
+    return TYPE_MISMATCH_ERR;
+  }
+  return seargs_get_at_(parser, i, out);
+}
+
+seargs_err_codes seargs_get_at_(const parser_t *parser, int index,
+                                arg_val_t *out) {
+  if (seargs_bit_(parser->lazy, index)) {
+    // converted again on every call, memoizing would write to the parser
+    return convert_value_(parser->defs[index].type,
+                          parser->values[index].string_val, out)
+               ? INVALID_VALUE_ERR
+               : SEARGS_OK;
   }
-  return NULL; // not found
+  *out = parser->values[index];
+  return SEARGS_OK;
 }
 
 // Returns null if the arg was not found
@@ -3,8 +3,14 @@
 
 #include <errno.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <string.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 // -------------------- MACROS TO BE USED BY THE USER --------------------------
 #define REQUIRED_INT_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)                   \
   ARG_DEF(LONG_NAME, SHORT_NAME, ARG_INT, DESCRIPTION, true, (arg_val_t){0})
@@ -14,6 +20,50 @@
 #define REQUIRED_STRING_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)                \
   ARG_DEF(LONG_NAME, SHORT_NAME, ARG_STRING, DESCRIPTION, true, (arg_val_t){0})
 
+// 64-bit integers and sizes, sizes accept K/M/G/T (powers of 1000) and
+// Ki/Mi/Gi/Ti (powers of 1024) suffixes e.g 64K or 2Gi
+#define REQUIRED_INT64_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)                 \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_INT64, DESCRIPTION, true, (arg_val_t){0})
+#define REQUIRED_UINT64_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)                \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_UINT64, DESCRIPTION, true, (arg_val_t){0})
+#define REQUIRED_SIZE_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)                  \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_SIZE, DESCRIPTION, true, (arg_val_t){0})
+
+// repeatable args, every occurrence is collected and they default to empty
+#define REQUIRED_INT_LIST_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)              \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_INT_LIST, DESCRIPTION, true,              \
+          (arg_val_t){0})
+#define REQUIRED_DOUBLE_LIST_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)           \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_DOUBLE_LIST, DESCRIPTION, true,           \
+          (arg_val_t){0})
+#define REQUIRED_STRING_LIST_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)           \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_STRING_LIST, DESCRIPTION, true,           \
+          (arg_val_t){0})
+#define OPTIONAL_INT_LIST_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)              \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_INT_LIST, DESCRIPTION, false,             \
+          (arg_val_t){0})
+#define OPTIONAL_DOUBLE_LIST_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)           \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_DOUBLE_LIST, DESCRIPTION, false,          \
+          (arg_val_t){0})
+#define OPTIONAL_STRING_LIST_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)           \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_STRING_LIST, DESCRIPTION, false,          \
+          (arg_val_t){0})
+
+// comma separated numbers in one value e.g --ids 1,2,3, read like lists.
+// Repeating the arg appends and they default to empty.
+#define REQUIRED_INT_ARRAY_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)             \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_INT_ARRAY, DESCRIPTION, true,             \
+          (arg_val_t){0})
+#define REQUIRED_DOUBLE_ARRAY_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)          \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_DOUBLE_ARRAY, DESCRIPTION, true,          \
+          (arg_val_t){0})
+#define OPTIONAL_INT_ARRAY_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)             \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_INT_ARRAY, DESCRIPTION, false,            \
+          (arg_val_t){0})
+#define OPTIONAL_DOUBLE_ARRAY_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)          \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_DOUBLE_ARRAY, DESCRIPTION, false,         \
+          (arg_val_t){0})
+
 // using explicit macros you dont need to wrap your value with macros like
 // INT_VAL() on the user side as thats already handled
 #define OPTIONAL_INT_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION, DEFAULT)          \
@@ -25,6 +75,16 @@
 #define OPTIONAL_STRING_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION, DEFAULT)       \
   ARG_DEF(LONG_NAME, SHORT_NAME, ARG_STRING, DESCRIPTION, false,               \
           STRING_VAL(DEFAULT))
+#define OPTIONAL_INT64_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION, DEFAULT)        \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_INT64, DESCRIPTION, false,                \
+          INT64_VAL(DEFAULT))
+#define OPTIONAL_UINT64_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION, DEFAULT)       \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_UINT64, DESCRIPTION, false,               \
+          UINT64_VAL(DEFAULT))
+// DEFAULT is a byte count, not a string
+#define OPTIONAL_SIZE_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION, DEFAULT)         \
+  ARG_DEF(LONG_NAME, SHORT_NAME, ARG_SIZE, DESCRIPTION, false,                 \
+          SIZE_VAL(DEFAULT))
 #define FLAG_ARG(LONG_NAME, SHORT_NAME, DESCRIPTION)                           \
   ARG_DEF(LONG_NAME, SHORT_NAME, ARG_FLAG, DESCRIPTION, false, FLAG_VAL)
 
@@ -46,6 +106,60 @@
   seargs_try(parser, get_string_arg_(parser, name))
 #define GET_FLAG_ARG(parser, name)                                             \
   seargs_try(parser, get_flag_arg_(parser, name))
+#define GET_INT64_ARG(parser, name)                                            \
+  seargs_try(parser, get_int64_arg_(parser, name))
+#define GET_UINT64_ARG(parser, name)                                           \
+  seargs_try(parser, get_uint64_arg_(parser, name, ARG_UINT64))
+#define GET_SIZE_ARG(parser, name)                                             \
+  seargs_try(parser, get_uint64_arg_(parser, name, ARG_SIZE))
+
+// list getters return a pointer to the items and store their number in *count
+#define GET_INT_LIST_ARG(parser, name, count)                                  \
+  seargs_try(parser, (const int *)get_list_arg_(parser, name, ARG_INT_LIST,   \
+                                                 count))
+#define GET_DOUBLE_LIST_ARG(parser, name, count)                               \
+  seargs_try(parser, (const double *)get_list_arg_(parser, name,              \
+                                                    ARG_DOUBLE_LIST, count))
+#define GET_STRING_LIST_ARG(parser, name, count)                               \
+  seargs_try(parser, (const char *const *)get_list_arg_(                      \
+                         parser, name, ARG_STRING_LIST, count))
+#define GET_INT_ARRAY_ARG(parser, name, count)                                 \
+  seargs_try(parser, (const int *)get_list_arg_(parser, name, ARG_INT_ARRAY,  \
+                                                 count))
+#define GET_DOUBLE_ARRAY_ARG(parser, name, count)                              \
+  seargs_try(parser, (const double *)get_list_arg_(parser, name,              \
+                                                    ARG_DOUBLE_ARRAY, count))
+
+// Resolve an arg once into a handle and read it through the handle afterwards,
+// the name lookup and type check only happen in the RESOLVE_* call. Check the
+// handle with seargs_handle_ok() before using it with the GET_*_HANDLE macros.
+#define RESOLVE_INT_ARG(parser, name) seargs_resolve(parser, name, ARG_INT)
+#define RESOLVE_DOUBLE_ARG(parser, name)                                       \
+  seargs_resolve(parser, name, ARG_DOUBLE)
+#define RESOLVE_STRING_ARG(parser, name)                                       \
+  seargs_resolve(parser, name, ARG_STRING)
+#define RESOLVE_FLAG_ARG(parser, name) seargs_resolve(parser, name, ARG_FLAG)
+#define RESOLVE_INT64_ARG(parser, name) seargs_resolve(parser, name, ARG_INT64)
+#define RESOLVE_UINT64_ARG(parser, name)                                       \
+  seargs_resolve(parser, name, ARG_UINT64)
+#define RESOLVE_SIZE_ARG(parser, name) seargs_resolve(parser, name, ARG_SIZE)
+
+#define seargs_handle_ok(h) ((h).index >= 0)
+
+// Handles stay valid across seargs_reset() and seargs_reparse(), a value still
+// pending under SEARGS_LAZY is converted on its first read through a handle.
+#define GET_INT_HANDLE(parser, h) (seargs_handle_value_(parser, h)->int_val)
+#define GET_DOUBLE_HANDLE(parser, h)                                           \
+  (seargs_handle_value_(parser, h)->double_val)
+#define GET_FLOAT_HANDLE(parser, h) ((float)GET_DOUBLE_HANDLE(parser, h))
+#define GET_STRING_HANDLE(parser, h)                                           \
+  ((const char *)seargs_handle_value_(parser, h)->string_val)
+#define GET_FLAG_HANDLE(parser, h) (seargs_handle_value_(parser, h)->flag_val)
+#define GET_INT64_HANDLE(parser, h)                                            \
+  (seargs_handle_value_(parser, h)->int64_val)
+#define GET_UINT64_HANDLE(parser, h)                                           \
+  (seargs_handle_value_(parser, h)->uint64_val)
+#define GET_SIZE_HANDLE(parser, h) GET_UINT64_HANDLE(parser, h)
 
 // -----------------------------------------------------------------------------
 
@@ -61,10 +175,60 @@
 #define OPTIONAL_ARG(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, DEFAULT)        \
   ARG_DEF(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, false, DEFAULT)
 
+// Same as the above but falling back to the environment variable ENV when the
+// arg is not in argv, i.e argv > ENV > DEFAULT
+#define ARG_DEF_ENV(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, REQUIRED,        \
+                    DEFAULT, ENV)                                              \
+  (arg_def_t) {                                                                \
+    .name = LONG_NAME, .short_name = SHORT_NAME, .desc = DESCRIPTION,          \
+    .required = REQUIRED, .type = TYPE, .default_val = DEFAULT, .env = ENV,    \
+  }
+#define REQUIRED_ENV_ARG(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, ENV)        \
+  ARG_DEF_ENV(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, true, (arg_val_t){0},  \
+              ENV)
+#define OPTIONAL_ENV_ARG(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, DEFAULT,    \
+                         ENV)                                                  \
+  ARG_DEF_ENV(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, false, DEFAULT, ENV)
+
+// Same as REQUIRED_ARG()/OPTIONAL_ARG() but a successful parse also stores the
+// value in *DEST, e.g &config.port for an ARG_INT. Defaults are stored too.
+// The value is parsed into the parser like any other and copied to *DEST once
+// the whole parse succeeded, so a failed parse leaves every DEST untouched and
+// the getters keep working for bound args.
+#define ARG_DEF_BIND(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, REQUIRED,       \
+                     DEFAULT, DEST)                                            \
+  (arg_def_t) {                                                                \
+    .name = LONG_NAME, .short_name = SHORT_NAME, .desc = DESCRIPTION,          \
+    .required = REQUIRED, .type = TYPE, .default_val = DEFAULT,                \
+    .bind = (void *)(DEST),                                                    \
+  }
+#define REQUIRED_BOUND_ARG(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, DEST)     \
+  ARG_DEF_BIND(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, true, (arg_val_t){0}, \
+               DEST)
+#define OPTIONAL_BOUND_ARG(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, DEFAULT,  \
+                           DEST)                                               \
+  ARG_DEF_BIND(LONG_NAME, SHORT_NAME, TYPE, DESCRIPTION, false, DEFAULT, DEST)
+
 // NOTE: Only use this macro if defs is a static array in scope, doesnt work
 // with pointers if so use parse_args()
 #define PARSE_ARGS(argc, argv, defs)                                           \
   ((defs) ? parse_args(argc, argv, defs, sizeof(defs) / sizeof(defs[0])) : NULL)
+// Same as PARSE_ARGS() but takes seargs_flags_t flags or'd together
+#define PARSE_ARGS_EX(argc, argv, defs, flags)                                 \
+  ((defs) ? parse_args_ex(argc, argv, defs, sizeof(defs) / sizeof(defs[0]),    \
+                          flags)                                               \
+          : NULL)
+
+// Defines a subcommand for parse_commands() from a static array of defs
+#define SUBCOMMAND(NAME, DESCRIPTION, DEFS)                                    \
+  (seargs_command_t) {                                                         \
+    .name = NAME, .desc = DESCRIPTION, .defs = DEFS,                           \
+    .num_args = sizeof(DEFS) / sizeof(DEFS[0]),                                \
+  }
+// NOTE: Same restrictions as PARSE_ARGS(), defs and commands must be arrays
+#define PARSE_COMMANDS(argc, argv, defs, commands)                             \
+  parse_commands(argc, argv, defs, sizeof(defs) / sizeof(defs[0]), commands,   \
+                 sizeof(commands) / sizeof(commands[0]), SEARGS_DEFAULT)
 
 // This expects you to pass a static string, dynamic strings may cause dangling
 // pointers.
@@ -74,9 +238,59 @@
 // defaulted as false
 #define FLAG_VAL ((arg_val_t){.flag_val = false})
 #define DOUBLE_VAL(value) ((arg_val_t){.double_val = (value)})
+#define INT64_VAL(value) ((arg_val_t){.int64_val = (value)})
+#define UINT64_VAL(value) ((arg_val_t){.uint64_val = (value)})
+#define SIZE_VAL(value) ((arg_val_t){.uint64_val = (value)})
 
 // The type of the arg (int, float, string or flag)
-typedef enum { ARG_FLAG, ARG_INT, ARG_STRING, ARG_DOUBLE } arg_type_t;
+typedef enum {
+  ARG_FLAG,
+  ARG_INT,
+  ARG_STRING,
+  ARG_DOUBLE,
+  ARG_INT64,
+  ARG_UINT64,
+  ARG_SIZE, // uint64_t byte count, accepts K/M/G/T and Ki/Mi/Gi/Ti suffixes
+  // repeatable args collecting every occurrence into an arg_list_t
+  ARG_INT_LIST,
+  ARG_DOUBLE_LIST,
+  ARG_STRING_LIST,
+  // comma separated numbers in a single value, stored like the lists
+  ARG_INT_ARRAY,
+  ARG_DOUBLE_ARRAY,
+} arg_type_t;
+
+// Flags changing how parse_args_ex() behaves, or them together
+typedef enum {
+  SEARGS_DEFAULT = 0,
+  // By default string values borrow from argv and from the (static) defaults,
+  // this duplicates them instead so they stay valid if argv is modified.
+  SEARGS_COPY_STRINGS = 1 << 0,
+  // Expands @file arguments (before --) into the whitespace separated tokens
+  // of the file, supporting quotes and nested response files. Not available
+  // for parse_args_into().
+  SEARGS_RESPONSE_FILES = 1 << 1,
+  // Stops parsing at the first positional, which and everything after it ends
+  // up in pos_args. parse_commands() uses it to find the subcommand.
+  SEARGS_STOP_AT_POSITIONAL = 1 << 2,
+  // Numeric values are only converted and validated when first read through
+  // a getter or seargs_resolve(), until then the state keeps the text. Invalid
+  // values then fail the read instead of the parse. Values of bound args and
+  // values copied with SEARGS_COPY_STRINGS are still converted while parsing.
+  SEARGS_LAZY = 1 << 3,
+  // Unknown options are collected into parser->passthrough instead of failing
+  // the parse, each with the non-option tokens following it, and so is
+  // everything after --. A cluster of short options passes through as a whole
+  // if any of its options is unknown, e.g. -vO with an unknown -O.
+  SEARGS_PASSTHROUGH = 1 << 4,
+} seargs_flags_t;
+
+// Shells print_completion() can write scripts for
+typedef enum {
+  SEARGS_SHELL_BASH,
+  SEARGS_SHELL_ZSH,
+  SEARGS_SHELL_FISH,
+} seargs_shell_t;
 
 typedef enum {
   SEARGS_OK = 0,
@@ -85,19 +299,40 @@ typedef enum {
   UNKNOWN_ARG_ERR,
   MISSING_VALUE_ERR,
   INVALID_ARG_ERR,
+  TYPE_MISMATCH_ERR,
+  INVALID_DEF_ERR,
+  BUFFER_TOO_SMALL_ERR,
+  RESPONSE_FILE_ERR,
+  CONFIG_FILE_ERR,
+  FILE_READ_ERR,
+  OUT_OF_MEMORY_ERR, // the heap ran out, the parse stopped halfway
 } seargs_err_codes;
 
 typedef struct {
   seargs_err_codes code;
   const char *msg;
   const char *arg_name;
+  const char *file; // config file the error is in, NULL otherwise
+  int line;         // line in file from 1, 0 if it could not be read
+  int element;      // failed item of an array value from 1, 0 otherwise
 } seargs_error_t;
 
+// Value of a list or array arg, the count items (int, double or const char *)
+// are stored contiguously right after the header, see the GET_*_LIST_ARG and
+// GET_*_ARRAY_ARG macros.
+typedef struct {
+  int count;
+  int capacity;
+} arg_list_t;
+
 typedef union {
   bool flag_val;
   int int_val;
   char *string_val;
   double double_val;
+  int64_t int64_val;
+  uint64_t uint64_val; // ARG_UINT64 and ARG_SIZE
+  arg_list_t *list_val; // NULL until the first occurrence
 } arg_val_t;
 
 // Representation of an arg, provides necessary metadata
@@ -108,54 +343,296 @@ typedef struct {
   const bool required;
   const arg_type_t type;
   const arg_val_t default_val;
+  const char *env; // environment variable backing the arg, may be NULL
+  // where a successful parse stores the value (bool, int, double,
+  // const char *, int64_t, uint64_t or size_t by type), may be NULL. Lists
+  // cannot be bound.
+  void *bind;
 } arg_def_t;
 
-// State of the argument, contains its value and whether it is found or not.
+// Counters and timings of a parser, only collected when the library is built
+// with SEARGS_STATS (cmake -DSEARGS_STATS=ON). Reset by seargs_reset().
 typedef struct {
-  arg_val_t value;
-  bool found;
-  bool string_allocated;
-} arg_state_t;
+  uint64_t tokens;       // argv tokens processed, option values included
+  uint64_t lookups;      // name lookups while parsing and in GET_*_ARG()
+  uint64_t compares;     // names compared during those lookups
+  uint64_t allocations;  // heap allocations made for the parser
+  uint64_t bytes_copied; // bytes of string copies (SEARGS_COPY_STRINGS)
+  uint64_t validate_ns;  // compiling the defs, 0 for precompiled specs
+  uint64_t parse_ns;     // argv, environment and config file
+  uint64_t defaults_ns;  // filling in defaults and bound destinations
+} seargs_stats_t;
 
-// list of args with their definitions and states.
+typedef enum {
+  SEARGS_PHASE_VALIDATE,
+  SEARGS_PHASE_PARSE,
+  SEARGS_PHASE_DEFAULTS,
+} seargs_phase_t;
+
+// Called at the end of every phase with the time it took and the stats so far
+typedef void (*seargs_phase_hook_t)(void *ctx, seargs_phase_t phase,
+                                    uint64_t ns, const seargs_stats_t *stats);
+
+// A subcommand of parse_commands() with its own options
+typedef struct {
+  const char *name;
+  const char *desc;
+  const arg_def_t *defs; // may be NULL for a subcommand without options
+  int num_args;
+} seargs_command_t;
+
+// Words of a bitset with one bit per arg, bit i is bit i % 64 of word i / 64
+#define SEARGS_BITSET_WORDS(num_args) (((num_args) + 63) / 64)
+
+static inline bool seargs_bit_(const uint64_t *bits, int i) {
+  return (bits[i >> 6] >> (i & 63)) & 1;
+}
+
+// An arg_def_t array compiled once by seargs_compile(): validated, indexed and
+// with the default values precomputed, any number of parses can reuse it.
+typedef struct {
+  const arg_def_t *defs;
+  int num_args;
+  // open addressing table over defs[].name, holds def index + 1 (0 is empty).
+  // index_cap is always a power of two.
+  int *name_index;
+  int index_cap;
+  // def index + 1 for every short_name, 0 if the char is not a short name
+  int short_index[256];
+  arg_val_t *defaults; // values of all args before anything is parsed
+  // bitsets of the required args and of the string args with a default,
+  // SEARGS_BITSET_WORDS(num_args) words each
+  uint64_t *required;
+  uint64_t *string_defaults;
+  int num_required;
+  int *env_index; // name index over defs[].env, same capacity as name_index
+  int num_env;    // defs with an env
+  int *bound;     // indexes of the args with a bind destination
+  int num_bound;
+} seargs_spec_t;
+
+// Pre-resolved reference to an arg of a parser, see seargs_resolve()
 typedef struct {
+  int index; // index into parser->values, -1 if resolving failed
+  arg_type_t type;
+} seargs_handle_t;
+
+// A response file loaded by the parser, tokens point into data
+typedef struct {
+  char *data;
+  size_t size;
+  bool mapped; // data is a private mapping of the file, not heap memory
+} seargs_file_t;
+
+// list of args with their definitions and states.
+typedef struct seargs_parser {
   int num_args;
   const arg_def_t *defs;
-  arg_state_t *states;
+  // state of the args, indexed like defs: the values and bitsets of them (see
+  // seargs_bit_()) of SEARGS_BITSET_WORDS(num_args) words each. Args set from
+  // their environment variable or the config file count as found.
+  arg_val_t *values;
+  uint64_t *found;
+  uint64_t *allocated;   // value points into memory owned by the parser
+  uint64_t *from_config; // value came from the config file
+  uint64_t *lazy; // SEARGS_LAZY: values[i].string_val is the text, unconverted
   seargs_error_t error;
   const char **pos_args;
   int num_pos_args;
+  // SEARGS_PASSTHROUGH: argv[0] followed by the tokens passed through in
+  // their order and a NULL, ready to be the argv of a child process. The
+  // tokens are borrowed from argv and the array lives in the arena.
+  const char **passthrough;
+  int num_passthrough; // entries before the NULL, argv[0] included
+  unsigned flags; // seargs_flags_t the parser was created with
+  // string copies and lists are carved out of the arena, for parsers in caller
+  // storage (parse_args_into()) it is the rest of the callers buffer,
+  // otherwise it is the newest of the heap chunks the parser owns
+  char *arena;
+  size_t arena_size;
+  size_t arena_used;
+  size_t arena_wanted; // arena bytes requested since the last reset
+  union seargs_chunk *chunks; // heap memory behind the arena, internal
+  bool external; // lives in caller storage, free_parser() wont free it
+  const seargs_spec_t *spec; // compiled form of defs used for lookups
+  // argv with every @file expanded (SEARGS_RESPONSE_FILES), only used when
+  // argv had any. pos_args points into it then.
+  const char **tokens;
+  int num_tokens;
+  int tokens_cap;
+  seargs_file_t *files;
+  int num_files;
+  int files_cap;
+  const char *config; // see seargs_set_config()
+  int config_line;    // line of config being applied, 0 when not applying it
+  // subcommand selected by parse_commands() and the parser holding its
+  // options, both NULL when no subcommand was given
+  const seargs_command_t *command;
+  struct seargs_parser *sub;
+#if defined(SEARGS_STATS)
+  seargs_stats_t stats;
+  seargs_phase_hook_t phase_hook;
+  void *phase_hook_ctx;
+#endif
 } parser_t;
 
+// Parses argv against defs, returns NULL on failure. An argc of 1 prints the
+// help and fails unless some defs read the environment or are bound.
 parser_t *parse_args(int argc, const char *argv[], const arg_def_t *args_defs,
                      size_t num_args);
+parser_t *parse_args_ex(int argc, const char *argv[], const arg_def_t *args_defs,
+                        size_t num_args, unsigned flags);
+// Parses the global options in args_defs up to the first positional, which
+// selects one of commands. The options after it are parsed against that
+// subcommands defs into parser->sub, parser->command is the subcommand. Only
+// the global defs and those of the selected subcommand are validated and
+// indexed. Without a subcommand in argv both are NULL, an unknown subcommand
+// fails like an unknown argument. args_defs may be NULL with a num_args of 0
+// for programs without global options. free_parser() frees parser->sub too.
+parser_t *parse_commands(int argc, const char *argv[],
+                         const arg_def_t *args_defs, size_t num_args,
+                         const seargs_command_t *commands,
+                         size_t num_commands, unsigned flags);
+// Bytes of caller storage parse_args_into() needs for num_args defs when
+// strings are borrowed and no list or array is given a value. Use
+// seargs_required_bytes_for() when that is not the case.
+size_t seargs_required_bytes(size_t num_args);
+// Bytes of caller storage parse_args_into() needs to parse this argc/argv
+// with these flags, string copies, lists, arrays and SEARGS_PASSTHROUGH
+// included. Sized by a trial parse on the heap against the current
+// environment, any errors it finds are printed like parse_args() would.
+// Returns 0 for invalid defs or if the heap ran out.
+size_t seargs_required_bytes_for(int argc, const char *argv[],
+                                 const arg_def_t *args_defs, size_t num_args,
+                                 unsigned flags);
+// Validates and compiles defs once, returns NULL if they are invalid. defs must
+// outlive the spec and the spec must outlive every parser made from it.
+seargs_spec_t *seargs_compile(const arg_def_t *defs, size_t num_args);
+void seargs_free_spec(seargs_spec_t **p_spec);
+// Same as parse_args_ex() for an already compiled spec, the defs are not
+// validated again and an argc of 1 is not treated as an error.
+parser_t *seargs_parse(const seargs_spec_t *spec, int argc, const char *argv[],
+                       unsigned flags);
+// Creates a parser holding only the defaults of spec, for use with
+// seargs_reparse()
+parser_t *seargs_new_parser(const seargs_spec_t *spec, unsigned flags);
+// Drops everything parsed so far, leaving the parser as seargs_new_parser()
+// would create it. Memory of the parser is kept for reuse.
+void seargs_reset(parser_t *parser);
+// Splits line into tokens like a shell would (whitespace, '...', "..." and
+// backslash escapes) in place and parses them into the parser, the first
+// token taking the place of argv[0]. Values borrow from line, which must stay
+// alive and unmodified while they are used. @file is not expanded. Returns
+// parser->error.code like seargs_reparse().
+seargs_err_codes seargs_parse_line(parser_t *parser, char *line);
+// Called by seargs_parse_lines() for every command, parser->error tells if it
+// parsed. Return false to stop.
+typedef bool (*seargs_line_fn)(void *ctx, parser_t *parser, int line);
+// Parses every line of the file at path with seargs_parse_line() and passes
+// the result to fn. Blank lines and lines starting with # are skipped. The
+// file is mapped once and tokenized in place, values only live until fn
+// returns. Errors carry the path and line in parser->error. Returns
+// FILE_READ_ERR if the file cannot be read, the error code of the line fn
+// stopped at or SEARGS_OK.
+seargs_err_codes seargs_parse_lines(parser_t *parser, const char *path,
+                                    seargs_line_fn fn, void *ctx);
+// Stats of the parser, NULL unless built with SEARGS_STATS
+const seargs_stats_t *seargs_stats(const parser_t *parser);
+// Sets the hook called at the end of every phase of the following parses,
+// returns false unless built with SEARGS_STATS. Parsers from parse_args() only
+// exist after parsing so this is meant for seargs_reparse().
+bool seargs_set_phase_hook(parser_t *parser, seargs_phase_hook_t hook,
+                           void *ctx);
+// Makes the next seargs_reparse() read `key = value` lines from the config
+// file at path for the args not given in argv or the environment. The path is
+// borrowed and kept until changed, NULL turns the config file off.
+void seargs_set_config(parser_t *parser, const char *path);
+// Resets the parser and parses argv into it, reusing its states and string
+// storage so steady state reparsing does not allocate. The parser stays valid
+// on failure with parser->error describing it, OUT_OF_MEMORY_ERR if the heap
+// ran out. Returns parser->error.code
+seargs_err_codes seargs_reparse(parser_t *parser, int argc,
+                                const char *argv[]);
+// Same as parse_args_ex() but the parser and any string copies live in buf so
+// the parse never touches the heap. *out_parser is set to the parser (inside
+// buf) whenever one could be built, also when parsing fails so parser->error
+// can be inspected. Returns BUFFER_TOO_SMALL_ERR if buf cannot hold the parser
+// or the string copies and INVALID_DEF_ERR for invalid defs. Unlike
+// parse_args_ex() an argc of 1 is not treated as an error. free_parser() is not
+// needed but is safe to call.
+seargs_err_codes parse_args_into(void *buf, size_t buf_size, int argc,
+                                 const char *argv[],
+                                 const arg_def_t *args_defs, size_t num_args,
+                                 unsigned flags, parser_t **out_parser);
 const arg_def_t *get_arg_def(const arg_def_t valid_args[], const char *name,
                              int num_defs);
 // Returns a void pointer with the value of the arg, strings are returned as is
 // and not a pointer, Returns null if not found
 void *get_arg_val(parser_t *parser, const char *name);
+// Returns the index of the def with the given long name in parser->defs, or -1
+// if there is no such def
+int get_arg_index_(const parser_t *parser, const char *name);
+// Same as get_arg_index_() but counted in parser->stats, for the getters that
+// may write to the parser anyway
+int seargs_lookup_(parser_t *parser, const char *name);
+// Converts the value of the arg at index if it is still pending (SEARGS_LAZY),
+// keeping the result. Returns false with parser->error set if it is invalid.
+bool seargs_convert_(parser_t *parser, int index);
+// Resolves name to a handle for reading the arg without further lookups. On
+// failure sets parser->error (UNKNOWN_ARG_ERR, TYPE_MISMATCH_ERR or
+// INVALID_VALUE_ERR for a lazy value) and returns a handle with index -1
+seargs_handle_t seargs_resolve(parser_t *parser, const char *name,
+                               arg_type_t type);
+// Reads the value of the arg with the given long name and type into *out
+// without writing to the parser, so any number of threads may read a parsed
+// parser at once. Returns SEARGS_OK, UNKNOWN_ARG_ERR, TYPE_MISMATCH_ERR,
+// INVALID_VALUE_ERR for an invalid lazy value or INVALID_ARG_ERR for NULL
+// arguments, *out is only written on success. Lazy values are converted on
+// every call. See the typed seargs_get_*() wrappers below.
+seargs_err_codes seargs_get(const parser_t *parser, const char *name,
+                            arg_type_t type, arg_val_t *out);
+// seargs_get() for the def at index in parser->defs, without the lookup and
+// the type check. Used by seargs.hpp where both are done at compile time.
+seargs_err_codes seargs_get_at_(const parser_t *parser, int index,
+                                arg_val_t *out);
 void free_parser(parser_t **p_parser);
 bool validate_arg_defs(const arg_def_t *defs, int num_args);
 void print_help(const arg_def_t *defs, int num_args);
+void print_commands(const seargs_command_t *commands, int num_commands);
+// Prints a static completion script for the program prog to stdout, so the
+// shell completes its options without running it. Values of string args
+// complete as file names, flags take no value and numbers are left to the
+// user. Returns false for a NULL prog or defs or an unknown shell.
+bool print_completion(const char *prog, const arg_def_t *defs, int num_args,
+                      seargs_shell_t shell);
 
 // ##########
 // <-------------- INTERNAL HELPER MACROS AND FUNCTIONS ------------------->
 // ##########
-static bool contains_format_specifier(const char *str) {
+static inline bool contains_format_specifier(const char *str) {
   if (!str)
     return false;
   return strchr(str, '%') != NULL;
 }
 
-static inline bool has_arg(parser_t *parser, const char *name) {
-  for (int i = 0; i < parser->num_args; i++)
-    if (strcmp(parser->defs[i].name, name) == 0)
-      return parser->states[i].found;
-  return false;
+static inline bool has_arg(const parser_t *parser, const char *name) {
+  int i = get_arg_index_(parser, name);
+  return i >= 0 && seargs_bit_(parser->found, i);
 }
 
-// gets the int value of an argument by its name, On Failure: sets the global
-// errno as EINVAL and returns 0
+// Value behind a resolved handle, converting it first if it is still pending
+// (SEARGS_LAZY). An invalid value reads as 0 with parser->error set.
+static inline const arg_val_t *seargs_handle_value_(parser_t *parser,
+                                                    seargs_handle_t h) {
+  static const arg_val_t zero = {false};
+  if (seargs_bit_(parser->lazy, h.index) && !seargs_convert_(parser, h.index)) {
+    return &zero;
+  }
+  return &parser->values[h.index];
+}
+
+// gets the int value of an argument by its name. On Failure: sets the error
+// code and returns 0
 static inline int get_int_arg_(parser_t *parser, const char *name) {
 
   const int *v = (const int *)get_arg_val(parser, name);
@@ -166,8 +643,8 @@ static inline int get_int_arg_(parser_t *parser, const char *name) {
   return *v;
 }
 
-// gets the double value of an argument by its name, On Failure: sets the global
-// errno as EINVAL and returns 0
+// gets the double value of an argument by its name. On Failure: sets the error
+// code and returns 0
 static inline double get_double_arg_(parser_t *parser, const char *name) {
   const double *v = (const double *)get_arg_val(parser, name);
   if (!v) {
@@ -177,14 +654,14 @@ static inline double get_double_arg_(parser_t *parser, const char *name) {
   return *v;
 }
 
-// gets the float value of an argument by its name, On Failure: sets the global
-// errno as EINVAL and returns 0
+// gets the float value of an argument by its name. On Failure: sets the error
+// code and returns 0
 static inline float get_float_arg_(parser_t *parser, const char *name) {
   return (float)get_double_arg_(parser, name);
 }
 
-// gets the char * value of an argument by its name, On Failure: sets the global
-// errno as EINVAL and returns NULL
+// gets the char * value of an argument by its name. On Failure: sets the error
+// code and returns NULL
 static inline const char *get_string_arg_(parser_t *parser, const char *name) {
   const char **v = (const char **)get_arg_val(parser, name);
   if (!v) {
@@ -195,7 +672,7 @@ static inline const char *get_string_arg_(parser_t *parser, const char *name) {
 }
 
 // gets the boolean/flag value of an argument by its name. On Failure: sets the
-// global errno as EINVAL and returns false
+// error code and returns false
 static inline bool get_flag_arg_(parser_t *parser, const char *name) {
   const bool *v = (const bool *)get_arg_val(parser, name);
   if (!v) {
@@ -205,4 +682,148 @@ static inline bool get_flag_arg_(parser_t *parser, const char *name) {
   return *v;
 }
 
-#endif
\ No newline at end of file
+// gets the int64_t value of an argument by its name. On Failure: sets the
+// error code and returns 0
+static inline int64_t get_int64_arg_(parser_t *parser, const char *name) {
+  int i = seargs_lookup_(parser, name);
+  if (i < 0 || parser->defs[i].type != ARG_INT64 ||
+      !seargs_convert_(parser, i)) {
+    parser->error.code = INVALID_VALUE_ERR;
+    return 0;
+  }
+  return parser->values[i].int64_val;
+}
+
+// gets the uint64_t value of an ARG_UINT64 or ARG_SIZE argument by its name.
+// On Failure: sets the error code and returns 0
+static inline uint64_t get_uint64_arg_(parser_t *parser, const char *name,
+                                       arg_type_t type) {
+  int i = seargs_lookup_(parser, name);
+  if (i < 0 || parser->defs[i].type != type || !seargs_convert_(parser, i)) {
+    parser->error.code = INVALID_VALUE_ERR;
+    return 0;
+  }
+  return parser->values[i].uint64_val;
+}
+
+// gets the items of a list argument by its name and stores their number in
+// *count, returns NULL for an empty list. On Failure: sets the error code and
+// returns NULL with *count as 0
+static inline const void *get_list_arg_(parser_t *parser, const char *name,
+                                        arg_type_t type, int *count) {
+  *count = 0;
+  int i = seargs_lookup_(parser, name);
+  if (i < 0 || parser->defs[i].type != type) {
+    parser->error.code = INVALID_VALUE_ERR;
+    return NULL;
+  }
+  const arg_list_t *list = parser->values[i].list_val;
+  if (!list) {
+    return NULL;
+  }
+  *count = list->count;
+  return list + 1;
+}
+
+// Thread-safe typed getters over seargs_get(), they only read the parser and
+// return the error code instead of setting it. *out is left untouched on
+// failure.
+static inline seargs_err_codes seargs_get_int(const parser_t *parser,
+                                              const char *name, int *out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, ARG_INT, &v);
+  if (err == SEARGS_OK) {
+    *out = v.int_val;
+  }
+  return err;
+}
+
+static inline seargs_err_codes
+seargs_get_double(const parser_t *parser, const char *name, double *out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, ARG_DOUBLE, &v);
+  if (err == SEARGS_OK) {
+    *out = v.double_val;
+  }
+  return err;
+}
+
+static inline seargs_err_codes
+seargs_get_float(const parser_t *parser, const char *name, float *out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, ARG_DOUBLE, &v);
+  if (err == SEARGS_OK) {
+    *out = (float)v.double_val;
+  }
+  return err;
+}
+
+static inline seargs_err_codes seargs_get_string(const parser_t *parser,
+                                                 const char *name,
+                                                 const char **out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, ARG_STRING, &v);
+  if (err == SEARGS_OK) {
+    *out = v.string_val;
+  }
+  return err;
+}
+
+static inline seargs_err_codes seargs_get_flag(const parser_t *parser,
+                                               const char *name, bool *out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, ARG_FLAG, &v);
+  if (err == SEARGS_OK) {
+    *out = v.flag_val;
+  }
+  return err;
+}
+
+static inline seargs_err_codes
+seargs_get_int64(const parser_t *parser, const char *name, int64_t *out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, ARG_INT64, &v);
+  if (err == SEARGS_OK) {
+    *out = v.int64_val;
+  }
+  return err;
+}
+
+static inline seargs_err_codes
+seargs_get_uint64(const parser_t *parser, const char *name, uint64_t *out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, ARG_UINT64, &v);
+  if (err == SEARGS_OK) {
+    *out = v.uint64_val;
+  }
+  return err;
+}
+
+static inline seargs_err_codes
+seargs_get_size(const parser_t *parser, const char *name, size_t *out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, ARG_SIZE, &v);
+  if (err == SEARGS_OK) {
+    *out = (size_t)v.uint64_val;
+  }
+  return err;
+}
+
+// Reads a list arg of the given type, *items is NULL for an empty list
+static inline seargs_err_codes
+seargs_get_list(const parser_t *parser, const char *name, arg_type_t type,
+                const void **items, int *count) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get(parser, name, type, &v);
+  if (err == SEARGS_OK) {
+    *items = v.list_val ? (const void *)(v.list_val + 1) : NULL;
+    *count = v.list_val ? v.list_val->count : 0;
+  }
+  return err;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
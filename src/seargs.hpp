@@ -0,0 +1,510 @@
+#ifndef SEARGS_HPP
+#define SEARGS_HPP
+
+// C++17 front end to seargs. Options are constexpr objects, a spec made of
+// them is validated and indexed by the compiler and values are read by their
+// index into parser->values without any name lookup:
+//
+//   inline constexpr auto port = seargs::optional<int>("port", 'p', "", 80);
+//   inline constexpr auto verbose = seargs::flag("verbose", 'v', "Verbose");
+//   using cli = seargs::spec<port, verbose>;
+//
+//   seargs::parser parser = cli::parse(argc, argv);
+//   if (parser.ok()) {
+//     int p = cli::get<port>(parser);
+//   }
+//
+// Duplicate names, short names or environment variables and '%' in names or
+// descriptions fail to compile.
+
+#include "seargs.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+namespace seargs {
+
+// Type tags of options without a C++ type of their own: repeatable lists,
+// comma separated arrays and byte sizes (read as uint64_t)
+template <typename T> struct list {};
+template <typename T> struct array {};
+struct size {};
+
+// Items of a list or array value, they live as long as the parser
+template <typename T> struct items {
+  using value_type = T;
+  const T *data;
+  int count;
+  const T *begin() const { return data; }
+  const T *end() const { return data + count; }
+};
+
+namespace detail {
+
+// arg_type_t of an option type, the type of its default and of its value
+template <typename T> struct traits;
+template <arg_type_t Type, typename Default, typename Value> struct traits_of {
+  static constexpr arg_type_t type = Type;
+  using default_type = Default;
+  using value_type = Value;
+};
+template <> struct traits<bool> : traits_of<ARG_FLAG, bool, bool> {};
+template <> struct traits<int> : traits_of<ARG_INT, int, int> {};
+template <> struct traits<double> : traits_of<ARG_DOUBLE, double, double> {};
+template <>
+struct traits<const char *>
+    : traits_of<ARG_STRING, const char *, const char *> {};
+template <>
+struct traits<int64_t> : traits_of<ARG_INT64, int64_t, int64_t> {};
+template <>
+struct traits<uint64_t> : traits_of<ARG_UINT64, uint64_t, uint64_t> {};
+template <> struct traits<size> : traits_of<ARG_SIZE, uint64_t, uint64_t> {};
+template <>
+struct traits<list<int>>
+    : traits_of<ARG_INT_LIST, std::nullptr_t, items<int>> {};
+template <>
+struct traits<list<double>>
+    : traits_of<ARG_DOUBLE_LIST, std::nullptr_t, items<double>> {};
+template <>
+struct traits<list<const char *>>
+    : traits_of<ARG_STRING_LIST, std::nullptr_t, items<const char *>> {};
+template <>
+struct traits<array<int>>
+    : traits_of<ARG_INT_ARRAY, std::nullptr_t, items<int>> {};
+template <>
+struct traits<array<double>>
+    : traits_of<ARG_DOUBLE_ARRAY, std::nullptr_t, items<double>> {};
+
+} // namespace detail
+
+// Description of one option, made with required(), optional() or flag()
+template <typename T> struct option {
+  using type = T;
+  const char *name;
+  char short_name;
+  const char *desc;
+  bool required;
+  typename detail::traits<T>::default_type default_val;
+  const char *env_var;
+
+  // Same option backed by the environment variable var, see arg_def_t.env
+  constexpr option env(const char *var) const {
+    option copy = *this;
+    copy.env_var = var;
+    return copy;
+  }
+};
+
+template <typename T>
+constexpr option<T> required(const char *name, char short_name,
+                             const char *desc) {
+  static_assert(!std::is_same_v<T, bool>, "seargs: flags cannot be required");
+  return {name, short_name, desc, true, {}, nullptr};
+}
+
+// Lists and arrays take no default, they default to empty
+template <typename T>
+constexpr option<T>
+optional(const char *name, char short_name, const char *desc,
+         typename detail::traits<T>::default_type default_val = {}) {
+  return {name, short_name, desc, false, default_val, nullptr};
+}
+
+constexpr option<bool> flag(const char *name, char short_name,
+                            const char *desc) {
+  return {name, short_name, desc, false, false, nullptr};
+}
+
+// Owns a parser_t and frees it, converts to parser_t * for the C API
+class parser {
+public:
+  explicit parser(parser_t *p = nullptr) : p_(p) {}
+  parser(parser &&other) noexcept : p_(other.p_) { other.p_ = nullptr; }
+  parser &operator=(parser &&other) noexcept {
+    if (this != &other) {
+      free_parser(&p_);
+      p_ = other.p_;
+      other.p_ = nullptr;
+    }
+    return *this;
+  }
+  parser(const parser &) = delete;
+  parser &operator=(const parser &) = delete;
+  ~parser() { free_parser(&p_); }
+
+  bool ok() const { return seargs_ok(p_); }
+  parser_t *get() const { return p_; }
+  parser_t *operator->() const { return p_; }
+  operator parser_t *() const { return p_; }
+
+private:
+  parser_t *p_;
+};
+
+namespace detail {
+
+// T of the option<T> behind a reference to it
+template <typename Ref>
+using option_type_t =
+    typename std::remove_cv_t<std::remove_reference_t<Ref>>::type;
+
+template <typename Ref>
+using value_t = typename traits<option_type_t<Ref>>::value_type;
+
+// What the checks and tables need of an option
+struct info {
+  const char *name;
+  char short_name;
+  const char *desc;
+  const char *env;
+  arg_type_t type;
+};
+
+constexpr bool equal(const char *a, const char *b) {
+  while (*a && *a == *b) {
+    a++;
+    b++;
+  }
+  return *a == *b;
+}
+
+constexpr bool has_percent(const char *s) {
+  for (; s && *s; s++) {
+    if (*s == '%') {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Same FNV-1a and capacity as the C name index so the tables below can be
+// used by the parser as they are
+constexpr unsigned long hash(const char *s) {
+  unsigned long h = 2166136261UL;
+  for (; *s; s++) {
+    h ^= (unsigned char)*s;
+    h *= 16777619UL;
+  }
+  return h;
+}
+
+constexpr std::size_t index_cap(std::size_t n) {
+  std::size_t cap = 8;
+  while (cap < n * 2) {
+    cap <<= 1;
+  }
+  return cap;
+}
+
+template <std::size_t N>
+constexpr bool names_valid(const std::array<info, N> &o) {
+  for (std::size_t i = 0; i < N; i++) {
+    if (!o[i].name || !*o[i].name) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <std::size_t N>
+constexpr bool names_unique(const std::array<info, N> &o) {
+  for (std::size_t i = 0; i < N; i++) {
+    for (std::size_t j = 0; j < i; j++) {
+      if (equal(o[i].name, o[j].name)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <std::size_t N>
+constexpr bool shorts_unique(const std::array<info, N> &o) {
+  for (std::size_t i = 0; i < N; i++) {
+    for (std::size_t j = 0; j < i && o[i].short_name; j++) {
+      if (o[i].short_name == o[j].short_name) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <std::size_t N>
+constexpr bool envs_unique(const std::array<info, N> &o) {
+  for (std::size_t i = 0; i < N; i++) {
+    for (std::size_t j = 0; j < i && o[i].env; j++) {
+      if (o[j].env && equal(o[i].env, o[j].env)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+template <std::size_t N>
+constexpr bool no_format_chars(const std::array<info, N> &o) {
+  for (std::size_t i = 0; i < N; i++) {
+    if (has_percent(o[i].name) || has_percent(o[i].desc)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Open addressing table of option index + 1 keyed by name (or env)
+template <std::size_t Cap, std::size_t N>
+constexpr std::array<int, Cap> build_index(const std::array<info, N> &o,
+                                           bool env) {
+  std::array<int, Cap> table{};
+  for (std::size_t i = 0; i < N; i++) {
+    const char *key = env ? o[i].env : o[i].name;
+    if (!key) {
+      continue;
+    }
+    std::size_t slot = hash(key) & (Cap - 1);
+    while (table[slot]) {
+      slot = (slot + 1) & (Cap - 1);
+    }
+    table[slot] = (int)i + 1;
+  }
+  return table;
+}
+
+template <std::size_t N>
+constexpr std::array<int, 256> build_short_index(const std::array<info, N> &o) {
+  std::array<int, 256> table{};
+  for (std::size_t i = 0; i < N; i++) {
+    if (o[i].short_name) {
+      table[(unsigned char)o[i].short_name] = (int)i + 1;
+    }
+  }
+  return table;
+}
+
+template <std::size_t N>
+constexpr int find(const std::array<info, N> &o, const char *name) {
+  for (std::size_t i = 0; i < N; i++) {
+    if (equal(o[i].name, name)) {
+      return (int)i;
+    }
+  }
+  return -1;
+}
+
+template <typename T> arg_val_t to_value(const option<T> &opt) {
+  arg_val_t value{};
+  if constexpr (std::is_same_v<T, bool>) {
+    value.flag_val = opt.default_val;
+  } else if constexpr (std::is_same_v<T, int>) {
+    value.int_val = opt.default_val;
+  } else if constexpr (std::is_same_v<T, double>) {
+    value.double_val = opt.default_val;
+  } else if constexpr (std::is_same_v<T, const char *>) {
+    value.string_val = const_cast<char *>(opt.default_val);
+  } else if constexpr (std::is_same_v<T, int64_t>) {
+    value.int64_val = opt.default_val;
+  } else if constexpr (std::is_same_v<T, uint64_t> ||
+                       std::is_same_v<T, size>) {
+    value.uint64_val = opt.default_val;
+  }
+  return value;
+}
+
+template <typename T> arg_def_t to_def(const option<T> &opt) {
+  return {opt.name,        opt.short_name, opt.desc,    opt.required,
+          traits<T>::type, to_value(opt),  opt.env_var, nullptr};
+}
+
+// Value of an option before anything is parsed
+template <typename T> arg_val_t to_default(const option<T> &opt) {
+  return opt.required ? arg_val_t{} : to_value(opt);
+}
+
+// Whether SEARGS_COPY_STRINGS has to copy the default of the option
+template <typename T> constexpr bool has_string_default(const option<T> &opt) {
+  if constexpr (std::is_same_v<T, const char *>) {
+    return !opt.required && opt.default_val;
+  } else {
+    return false;
+  }
+}
+
+template <std::size_t N>
+constexpr std::array<uint64_t, SEARGS_BITSET_WORDS(N)>
+build_bitset(const std::array<bool, N> &bits) {
+  std::array<uint64_t, SEARGS_BITSET_WORDS(N)> words{};
+  for (std::size_t i = 0; i < N; i++) {
+    words[i / 64] |= (uint64_t)bits[i] << (i % 64);
+  }
+  return words;
+}
+
+template <typename E> items<E> to_items(const arg_list_t *list) {
+  if (!list) {
+    return {nullptr, 0};
+  }
+  return {reinterpret_cast<const E *>(list + 1), list->count};
+}
+
+// Value of the state at index i as type T into out. Like seargs_get() a lazy
+// value is converted on every read without keeping the result, so the parser
+// is never written to. Returns INVALID_VALUE_ERR with out untouched if it is
+// invalid.
+template <typename T>
+seargs_err_codes read(const parser_t *parser, int i,
+                      typename traits<T>::value_type &out) {
+  arg_val_t v;
+  seargs_err_codes err = seargs_get_at_(parser, i, &v);
+  if (err != SEARGS_OK) {
+    return err;
+  }
+  if constexpr (std::is_same_v<T, bool>) {
+    out = v.flag_val;
+  } else if constexpr (std::is_same_v<T, int>) {
+    out = v.int_val;
+  } else if constexpr (std::is_same_v<T, double>) {
+    out = v.double_val;
+  } else if constexpr (std::is_same_v<T, const char *>) {
+    out = v.string_val;
+  } else if constexpr (std::is_same_v<T, int64_t>) {
+    out = v.int64_val;
+  } else if constexpr (std::is_same_v<T, uint64_t> ||
+                       std::is_same_v<T, size>) {
+    out = v.uint64_val;
+  } else {
+    out = to_items<typename traits<T>::value_type::value_type>(v.list_val);
+  }
+  return SEARGS_OK;
+}
+
+} // namespace detail
+
+// The options of a program, checked and indexed at compile time. Every
+// option has to be a constexpr object with static storage.
+template <const auto &...Opts> class spec {
+public:
+  static constexpr int num_args = sizeof...(Opts);
+  static_assert(num_args > 0, "seargs: a spec needs at least one option");
+
+private:
+  static constexpr std::array<detail::info, num_args> infos_{
+      {{Opts.name, Opts.short_name, Opts.desc, Opts.env_var,
+        detail::traits<detail::option_type_t<decltype(Opts)>>::type}...}};
+
+  static_assert(detail::names_valid(infos_),
+                "seargs: option names cannot be empty");
+  static_assert(detail::names_unique(infos_), "seargs: duplicate option name");
+  static_assert(detail::shorts_unique(infos_), "seargs: duplicate short name");
+  static_assert(detail::envs_unique(infos_),
+                "seargs: duplicate environment variable");
+  static_assert(detail::no_format_chars(infos_),
+                "seargs: option name or description contains '%'");
+
+  static constexpr std::size_t cap_ = detail::index_cap(num_args);
+  static constexpr std::array<int, cap_> name_index_ =
+      detail::build_index<cap_>(infos_, false);
+  static constexpr std::array<int, cap_> env_index_ =
+      detail::build_index<cap_>(infos_, true);
+  static constexpr std::array<int, 256> short_index_ =
+      detail::build_short_index(infos_);
+  static constexpr std::array<bool, num_args> required_flags_{
+      {Opts.required...}};
+  static constexpr auto required_ = detail::build_bitset(required_flags_);
+  static constexpr auto string_defaults_ = detail::build_bitset(
+      std::array<bool, num_args>{{detail::has_string_default(Opts)...}});
+
+  static seargs_spec_t make_spec_(const arg_def_t *defs,
+                                  arg_val_t *defaults) {
+    seargs_spec_t spec{};
+    spec.defs = defs;
+    spec.num_args = num_args;
+    // the parser only reads the tables, they stay in read-only memory
+    spec.name_index = const_cast<int *>(name_index_.data());
+    spec.index_cap = (int)cap_;
+    for (int c = 0; c < 256; c++) {
+      spec.short_index[c] = short_index_[c];
+    }
+    spec.defaults = defaults;
+    spec.required = const_cast<uint64_t *>(required_.data());
+    spec.string_defaults = const_cast<uint64_t *>(string_defaults_.data());
+    for (int i = 0; i < num_args; i++) {
+      spec.num_required += required_flags_[i];
+      spec.num_env += infos_[i].env != nullptr;
+    }
+    spec.env_index = const_cast<int *>(env_index_.data());
+    return spec;
+  }
+
+public:
+  // Index of the option named name, -1 if there is none
+  static constexpr int index_of(const char *name) {
+    return detail::find(infos_, name);
+  }
+
+  // The arg_def_t array of the spec, for print_help() and friends
+  static const arg_def_t *defs() {
+    static const arg_def_t defs[] = {detail::to_def(Opts)...};
+    return defs;
+  }
+
+  // The compiled spec filled in from the tables above, seargs_compile() is
+  // never called. Built on first use and never freed.
+  static const seargs_spec_t *compiled() {
+    static arg_val_t defaults[] = {detail::to_default(Opts)...};
+    static const seargs_spec_t spec = make_spec_(defs(), defaults);
+    return &spec;
+  }
+
+  static parser parse(int argc, const char *argv[],
+                      unsigned flags = SEARGS_DEFAULT) {
+    return parser(seargs_parse(compiled(), argc, argv, flags));
+  }
+  static parser parse(int argc, char *argv[], unsigned flags = SEARGS_DEFAULT) {
+    return parse(argc, const_cast<const char **>(argv), flags);
+  }
+
+  // Empty parser for seargs_reparse() and seargs_parse_line()
+  static parser new_parser(unsigned flags = SEARGS_DEFAULT) {
+    return parser(seargs_new_parser(compiled(), flags));
+  }
+
+  static void print_help() { ::print_help(defs(), num_args); }
+
+  // Value of Opt, a direct read of parser->values at an index known at
+  // compile time. Lists and arrays read as seargs::items. Only reads the
+  // parser, so any number of threads may call it at once. An invalid
+  // SEARGS_LAZY value reads as T{}, use the overload below to tell.
+  template <const auto &Opt>
+  static detail::value_t<decltype(Opt)> get(const parser_t *parser) {
+    detail::value_t<decltype(Opt)> value{};
+    get<Opt>(parser, value);
+    return value;
+  }
+
+  // Same as get() but stores the value in out and returns SEARGS_OK, or
+  // INVALID_VALUE_ERR for an invalid SEARGS_LAZY value with out untouched
+  template <const auto &Opt>
+  static seargs_err_codes get(const parser_t *parser,
+                              detail::value_t<decltype(Opt)> &out) {
+    using T = detail::option_type_t<decltype(Opt)>;
+    constexpr int i = index_of(Opt.name);
+    static_assert(i >= 0, "seargs: option is not part of this spec");
+    static_assert(infos_[i].type == detail::traits<T>::type,
+                  "seargs: option has another type in this spec");
+    return detail::read<T>(parser, i, out);
+  }
+
+  // Whether Opt was given in argv, the environment or the config file
+  template <const auto &Opt> static bool has(const parser_t *parser) {
+    constexpr int i = index_of(Opt.name);
+    static_assert(i >= 0, "seargs: option is not part of this spec");
+    return seargs_bit_(parser->found, i);
+  }
+};
+
+} // namespace seargs
+
+#endif